@@ -0,0 +1,19 @@
+#include "ArgumentPool.hpp"
+
+namespace lcdoc
+{
+	SharedArgs ArgumentPool::intern(vector<string> args)
+	{
+		string key;
+		for (const auto& arg : args)
+		{
+			key += arg;
+			key += '\0';
+		}
+
+		auto& list = m_lists[std::move(key)];
+		if (!list)
+			list = std::make_shared<const vector<string>>(std::move(args));
+		return list;
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+namespace lcdoc
+{
+	using std::string;
+	using std::vector;
+	using std::shared_ptr;
+
+	// an interned argument list, see ArgumentPool
+	using SharedArgs = shared_ptr<const vector<string>>;
+
+	// Interns the clang argument lists: the files compiled with the same flags share a single vector,
+	// so that equal lists are told by their pointer, e.g. to group the translation units
+	class ArgumentPool
+	{
+	public:
+
+		SharedArgs intern(vector<string> args);
+
+		// the number of distinct lists
+		size_t size() const { return m_lists.size(); }
+
+	private:
+		std::unordered_map<string, SharedArgs> m_lists; // by the arguments joined with '\0'
+	};
+}
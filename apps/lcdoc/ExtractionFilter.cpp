@@ -0,0 +1,80 @@
+#include "hash.hpp"
+
+#include "ExtractionFilter.hpp"
+
+namespace lcdoc
+{
+	bool glob_match(std::string_view pattern, std::string_view text, char separator)
+	{
+		if (pattern.empty())
+			return text.empty();
+
+		if (pattern.starts_with("**"))
+		{
+			const auto rest = pattern.substr(2);
+			for (size_t i = 0; i <= text.size(); ++i)
+				if (glob_match(rest, text.substr(i), separator))
+					return true;
+			return false;
+		}
+
+		if (pattern[0] == '*')
+		{
+			const auto rest = pattern.substr(1);
+			for (size_t i = 0; i <= text.size(); ++i)
+			{
+				if (glob_match(rest, text.substr(i), separator))
+					return true;
+				if (i < text.size() && text[i] == separator)
+					break;
+			}
+			return false;
+		}
+
+		if (text.empty())
+			return false;
+		if (pattern[0] != '?' && pattern[0] != text[0])
+			return false;
+		if (pattern[0] == '?' && text[0] == separator)
+			return false;
+		return glob_match(pattern.substr(1), text.substr(1), separator);
+	}
+
+	bool ExtractionFilter::acceptsFile(std::string_view file, bool mainFile) const
+	{
+		for (const auto& pattern : this->excludePaths)
+			if (glob_match(pattern, file))
+				return false;
+
+		if (mainFile)
+			return true;
+
+		for (const auto& pattern : this->includePaths)
+			if (glob_match(pattern, file))
+				return true;
+		return false;
+	}
+
+	bool ExtractionFilter::acceptsNamespace(std::string_view name, std::string_view qualifiedName) const
+	{
+		for (const auto& pattern : this->excludeNamespaces)
+		{
+			const bool qualified = pattern.find("::") != string::npos;
+			if (glob_match(pattern, qualified ? qualifiedName : name, ':'))
+				return false;
+		}
+		return true;
+	}
+
+	uint64_t ExtractionFilter::hash() const
+	{
+		uint64_t hash = fnv1a_basis;
+		for (const auto* patterns : { &this->includePaths, &this->excludePaths, &this->excludeNamespaces })
+		{
+			hash = hash_combine(hash, patterns->size());
+			for (const auto& pattern : *patterns)
+				hash = hash_bytes(pattern, hash_combine(hash, pattern.size()));
+		}
+		return hash_combine(hash, (uint64_t)this->access);
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+#include <clang-c/Index.h>
+
+namespace lcdoc
+{
+	using std::string;
+	using std::vector;
+
+	// Which declarations are extracted. The rules are checked before a subtree is walked, so an excluded
+	// namespace, class or file is never traversed. Globs accept `*` (within a path component or a name),
+	// `**` (anything) and `?`.
+	struct ExtractionFilter
+	{
+		// absolute globs of the files extracted besides the main file of each unit, e.g. the project headers
+		vector<string> includePaths;
+
+		// absolute globs of the files never extracted, the main files included
+		vector<string> excludePaths;
+
+		// namespaces skipped with their content: a name ("detail") or a qualified name ("lcdoc::detail")
+		vector<string> excludeNamespaces;
+
+		// the least visible access of the class members extracted
+		::CX_CXXAccessSpecifier access = ::CX_CXXPrivate;
+
+		// only the main file of each unit is extracted, as without any path rule
+		bool mainFileOnly() const { return this->includePaths.empty() && this->excludePaths.empty(); }
+
+		// `file` is absolute and normalized, `mainFile` tells if it is the main file of the unit
+		bool acceptsFile(std::string_view file, bool mainFile) const;
+
+		// `qualifiedName` is the name of the namespace with the enclosing ones, separated by "::"
+		bool acceptsNamespace(std::string_view name, std::string_view qualifiedName) const;
+
+		bool acceptsAccess(::CX_CXXAccessSpecifier access) const {
+			return access == ::CX_CXXInvalidAccessSpecifier || access <= this->access;
+		}
+
+		// changes whenever the extracted declarations may change, part of the symbol cache keys
+		uint64_t hash() const;
+	};
+
+	// `*` does not match `separator`, `**` matches anything
+	bool glob_match(std::string_view pattern, std::string_view text, char separator = '/');
+}
@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+#include "FrozenRegistry.hpp"
+#include "hash.hpp"
+
+namespace lcdoc
+{
+	FrozenRegistry::FrozenRegistry(const SymbolRegistry& registry)
+	{
+		const uint32_t n = (uint32_t)registry.symbols.size();
+
+		// sort by qualified id, the USR breaks the ties so that the order never depends on the parse order
+		vector<SymbolId> ids;
+		ids.reserve(n);
+		for (const auto& symbol : registry.symbols)
+			ids.push_back(registry.id(*symbol));
+
+		vector<uint32_t> order(n);
+		std::iota(order.begin(), order.end(), 0);
+		std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+			if (const auto c = ids[a] <=> ids[b]; c != 0)
+				return c < 0;
+			return registry.symbols.at(a)->usr() < registry.symbols.at(b)->usr();
+		});
+
+		vector<uint32_t> frozenIndex(n);
+		m_symbols.reserve(n);
+		m_ids.reserve(n);
+		for (uint32_t i = 0; i < n; ++i)
+		{
+			frozenIndex[order[i]] = i;
+			m_symbols.push_back(registry.symbols.at(order[i]));
+			m_ids.push_back(std::move(ids[order[i]]));
+		}
+
+		m_parents.assign(n, no_symbol);
+		m_childOffsets.assign(n + 1, 0);
+		for (uint32_t i = 0; i < n; ++i)
+			if (const auto parent = registry.parentOf(*m_symbols[i]))
+			{
+				m_parents[i] = frozenIndex[parent->index()];
+				++m_childOffsets[m_parents[i] + 1];
+			}
+			else
+				m_roots.push_back(i);
+
+		// children ranges: the symbols are visited in order, so every range is sorted
+		std::partial_sum(m_childOffsets.begin(), m_childOffsets.end(), m_childOffsets.begin());
+		m_children.resize(m_childOffsets[n]);
+		vector<uint32_t> filled(m_childOffsets.begin(), m_childOffsets.end() - 1);
+		for (uint32_t i = 0; i < n; ++i)
+			if (m_parents[i] != no_symbol)
+				m_children[filled[m_parents[i]]++] = i;
+
+		// the indexes of the registry, translated and sorted
+		const auto translated = [&](std::span<const uint32_t> indices, vector<uint32_t>& into) {
+			const auto first = into.size();
+			for (const uint32_t index : indices)
+				into.push_back(frozenIndex[index]);
+			std::sort(into.begin() + first, into.end());
+		};
+
+		for (size_t kind = 0; kind < symbol_kind_count; ++kind)
+		{
+			m_kindOffsets[kind] = (uint32_t)m_byKind.size();
+			translated(registry.ofKind((SymbolKind)kind), m_byKind);
+		}
+		m_kindOffsets[symbol_kind_count] = (uint32_t)m_byKind.size();
+
+		for (const auto& [file, indices] : registry.files())
+		{
+			const auto first = (uint32_t)m_byFile.size();
+			translated(indices, m_byFile);
+			m_fileRanges.emplace(file, std::pair(first, (uint32_t)m_byFile.size()));
+		}
+
+		this->buildHash();
+	}
+
+	void FrozenRegistry::buildHash()
+	{
+		const uint32_t n = (uint32_t)m_symbols.size();
+		m_seeds.assign(n, 0);
+		m_slots.assign(n, no_symbol);
+		if (n == 0)
+			return;
+
+		vector<uint64_t> hashes(n);
+		vector<vector<uint32_t>> buckets(n);
+		for (uint32_t i = 0; i < n; ++i)
+		{
+			hashes[i] = hash_bytes(m_symbols[i]->usr());
+			buckets[hash_seeded(hashes[i], 0) % n].push_back(i);
+		}
+
+		// the largest buckets are placed first, while most of the slots are still free
+		vector<uint32_t> bucketOrder(n);
+		std::iota(bucketOrder.begin(), bucketOrder.end(), 0);
+		std::stable_sort(bucketOrder.begin(), bucketOrder.end(), [&](uint32_t a, uint32_t b) {
+			return buckets[a].size() > buckets[b].size();
+		});
+
+		vector<bool> used(n, false);
+		vector<uint32_t> candidate;
+		size_t next = 0;
+		for (; next < bucketOrder.size() && buckets[bucketOrder[next]].size() > 1; ++next)
+		{
+			const auto& bucket = buckets[bucketOrder[next]];
+			for (uint32_t seed = 1;; ++seed)
+			{
+				if (seed == (1u << 24))
+					throw std::runtime_error("cannot build the perfect hash of the registry");
+
+				candidate.clear();
+				bool fits = true;
+				for (const uint32_t symbol : bucket)
+				{
+					const uint32_t slot = (uint32_t)(hash_seeded(hashes[symbol], seed) % n);
+					if (used[slot] || std::find(candidate.begin(), candidate.end(), slot) != candidate.end())
+					{
+						fits = false;
+						break;
+					}
+					candidate.push_back(slot);
+				}
+				if (!fits)
+					continue;
+
+				m_seeds[bucketOrder[next]] = (int32_t)seed;
+				for (size_t k = 0; k < bucket.size(); ++k)
+				{
+					used[candidate[k]] = true;
+					m_slots[candidate[k]] = bucket[k];
+				}
+				break;
+			}
+		}
+
+		// single key buckets take the remaining slots directly
+		uint32_t freeSlot = 0;
+		for (; next < bucketOrder.size() && !buckets[bucketOrder[next]].empty(); ++next)
+		{
+			while (used[freeSlot])
+				++freeSlot;
+			used[freeSlot] = true;
+			m_slots[freeSlot] = buckets[bucketOrder[next]].front();
+			m_seeds[bucketOrder[next]] = -(int32_t)freeSlot - 1;
+		}
+	}
+
+	uint32_t FrozenRegistry::indexOf(std::string_view usr) const
+	{
+		const uint32_t n = (uint32_t)m_symbols.size();
+		if (n == 0)
+			return no_symbol;
+
+		const uint64_t hash = hash_bytes(usr);
+		const uint32_t slot = perfect_hash_slot(hash, m_seeds[hash_seeded(hash, 0) % n], n);
+
+		// a USR that is not in the snapshot lands on any slot
+		const uint32_t index = m_slots[slot];
+		if (index == no_symbol || m_symbols[index]->usr() != usr)
+			return no_symbol;
+		return index;
+	}
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <span>
+#include <string_view>
+
+#include "Symbol.hpp"
+
+namespace lcdoc
+{
+	// Immutable snapshot of a registry, built once parsing is over: it is what the renderers see.
+	// The symbols are stored in flat arrays sorted by qualified id, the children of every symbol
+	// are a contiguous range and the USR lookup goes through a minimal perfect hash.
+	// Lookups and iteration do not allocate.
+	class FrozenRegistry
+	{
+	public:
+
+		explicit FrozenRegistry(const SymbolRegistry& registry);
+
+		FrozenRegistry(const FrozenRegistry&) = delete;
+		FrozenRegistry& operator=(const FrozenRegistry&) = delete;
+
+		size_t size() const { return m_symbols.size(); }
+
+		// all the symbols, sorted by qualified id
+		std::span<const shared_ptr<const Symbol>> symbols() const { return m_symbols; }
+
+		const Symbol& symbol(uint32_t index) const { return *m_symbols[index]; }
+
+		const SymbolId& id(uint32_t index) const { return m_ids[index]; }
+
+		// no_symbol for top level symbols
+		uint32_t parent(uint32_t index) const { return m_parents[index]; }
+
+		// sorted by qualified id
+		std::span<const uint32_t> children(uint32_t index) const {
+			return { m_children.data() + m_childOffsets[index], m_children.data() + m_childOffsets[index + 1] };
+		}
+
+		// the top level symbols, sorted by qualified id
+		std::span<const uint32_t> roots() const { return m_roots; }
+
+		// sorted by qualified id
+		std::span<const uint32_t> ofKind(SymbolKind kind) const {
+			return { m_byKind.data() + m_kindOffsets[(size_t)kind], m_byKind.data() + m_kindOffsets[(size_t)kind + 1] };
+		}
+
+		// the symbols declared or defined in `file`, sorted by qualified id
+		std::span<const uint32_t> declaredIn(InternedString file) const {
+			auto it = m_fileRanges.find(file);
+			if (it == m_fileRanges.end())
+				return {};
+			return { m_byFile.data() + it->second.first, m_byFile.data() + it->second.second };
+		}
+
+		// no_symbol if not found
+		uint32_t indexOf(std::string_view usr) const;
+
+		const Symbol* find(std::string_view usr) const {
+			const uint32_t index = this->indexOf(usr);
+			return index == no_symbol ? nullptr : m_symbols[index].get();
+		}
+
+		// the perfect hash tables, for serialization
+		std::span<const int32_t> hashSeeds() const { return m_seeds; }
+		std::span<const uint32_t> hashSlots() const { return m_slots; }
+
+		std::span<const uint32_t> allChildren() const { return m_children; }
+		std::span<const uint32_t> childOffsets() const { return m_childOffsets; }
+
+		// [first, last) ranges of fileSymbols()
+		const std::unordered_map<InternedString, std::pair<uint32_t, uint32_t>>& fileRanges() const { return m_fileRanges; }
+		std::span<const uint32_t> fileSymbols() const { return m_byFile; }
+
+	private:
+
+		void buildHash();
+
+		vector<shared_ptr<const Symbol>> m_symbols;
+		vector<SymbolId> m_ids;
+		vector<uint32_t> m_parents;
+		vector<uint32_t> m_childOffsets; // size() + 1 entries
+		vector<uint32_t> m_children;
+		vector<uint32_t> m_roots;
+
+		// built from the indexes of the registry
+		std::array<uint32_t, symbol_kind_count + 1> m_kindOffsets{};
+		vector<uint32_t> m_byKind;
+		std::unordered_map<InternedString, std::pair<uint32_t, uint32_t>> m_fileRanges;
+		vector<uint32_t> m_byFile;
+
+		// hash and displace: the first level hash selects a seed, the seeded hash selects the slot.
+		// A negative seed stores the slot of a single key bucket directly, as -(slot + 1).
+		vector<int32_t> m_seeds;
+		vector<uint32_t> m_slots; // slot -> symbol index
+	};
+}
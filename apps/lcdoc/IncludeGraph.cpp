@@ -0,0 +1,228 @@
+#include <fstream>
+#include <iostream>
+
+#include "binary_io.hpp"
+
+#include "IncludeGraph.hpp"
+
+namespace lcdoc
+{
+	namespace
+	{
+		constexpr uint32_t graph_magic = 0x4744434c; // "LCDG"
+		constexpr uint32_t graph_version = 1;
+	}
+
+	IncludeGraph IncludeGraph::load(const path& file)
+	{
+		IncludeGraph graph;
+
+		std::ifstream in(file, std::ios::binary);
+		if (!in)
+			return graph;
+
+		try
+		{
+			BinaryReader r(in);
+			if (r.u32() != graph_magic || r.u32() != graph_version)
+				return graph;
+
+			vector<string> files(r.u32());
+			for (auto& name : files)
+				name = r.str();
+
+			const auto fileAt = [&](uint32_t index) -> const string& {
+				if (index >= files.size())
+					throw std::runtime_error("file index out of range");
+				return files[index];
+			};
+
+			for (uint32_t n = r.u32(); n > 0; --n)
+			{
+				const string unit = fileAt(r.u32());
+				vector<clang::Inclusion> inclusions(r.u32());
+				for (auto& inclusion : inclusions)
+				{
+					inclusion.includer = fileAt(r.u32());
+					inclusion.included = fileAt(r.u32());
+				}
+				graph.setUnit(unit, inclusions);
+			}
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << "ignoring corrupted include graph " << file << ": " << e.what() << std::endl;
+			return IncludeGraph();
+		}
+
+		return graph;
+	}
+
+	void IncludeGraph::save(const path& file) const
+	{
+		// only the files still referenced are written, renumbered
+		std::unordered_map<uint32_t, uint32_t> renumbered;
+		vector<uint32_t> written;
+		const auto number = [&](uint32_t id) {
+			const auto [it, inserted] = renumbered.emplace(id, (uint32_t)written.size());
+			if (inserted)
+				written.push_back(id);
+			return it->second;
+		};
+		for (const auto& [unit, edges] : m_units)
+		{
+			number(unit);
+			for (const auto& [includer, included] : edges)
+			{
+				number(includer);
+				number(included);
+			}
+		}
+
+		path tmp = file;
+		tmp += ".tmp";
+		{
+			std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+			BinaryWriter w(out);
+
+			w.u32(graph_magic);
+			w.u32(graph_version);
+
+			w.u32((uint32_t)written.size());
+			for (const uint32_t id : written)
+				w.str(m_files[id]);
+
+			w.u32((uint32_t)m_units.size());
+			for (const auto& [unit, edges] : m_units)
+			{
+				w.u32(renumbered.at(unit));
+				w.u32((uint32_t)edges.size());
+				for (const auto& [includer, included] : edges)
+				{
+					w.u32(renumbered.at(includer));
+					w.u32(renumbered.at(included));
+				}
+			}
+
+			if (!out)
+			{
+				std::cerr << "could not write the include graph " << file << std::endl;
+				return;
+			}
+		}
+
+		std::error_code ec;
+		std::filesystem::rename(tmp, file, ec);
+		if (ec)
+			std::filesystem::remove(tmp, ec);
+	}
+
+	void IncludeGraph::setUnit(const path& unit, const vector<clang::Inclusion>& inclusions)
+	{
+		this->removeUnit(unit);
+
+		const uint32_t main = this->id(unit);
+		auto& edges = m_units[main];
+		m_dependents[main].insert(main);
+		for (const auto& inclusion : inclusions)
+		{
+			const uint32_t includer = this->id(inclusion.includer);
+			const uint32_t included = this->id(inclusion.included);
+			edges.emplace_back(includer, included);
+			m_dependents[includer].insert(main);
+			m_dependents[included].insert(main);
+		}
+	}
+
+	void IncludeGraph::removeUnit(const path& unit)
+	{
+		const auto main = this->find(unit);
+		if (!main)
+			return;
+
+		const auto it = m_units.find(*main);
+		if (it == m_units.end())
+			return;
+
+		const auto forget = [&](uint32_t file) {
+			const auto dependents = m_dependents.find(file);
+			if (dependents == m_dependents.end())
+				return;
+			dependents->second.erase(*main);
+			if (dependents->second.empty())
+				m_dependents.erase(dependents);
+		};
+
+		forget(*main);
+		for (const auto& [includer, included] : it->second)
+		{
+			forget(includer);
+			forget(included);
+		}
+		m_units.erase(it);
+	}
+
+	void IncludeGraph::retainUnits(const set<path>& units)
+	{
+		set<uint32_t> kept;
+		for (const auto& unit : units)
+			if (const auto id = this->find(unit))
+				kept.insert(*id);
+
+		vector<path> removed;
+		for (const auto& [unit, edges] : m_units)
+			if (!kept.contains(unit))
+				removed.push_back(m_files[unit]);
+
+		for (const auto& unit : removed)
+			this->removeUnit(unit);
+	}
+
+	set<path> IncludeGraph::affectedUnits(const set<path>& files) const
+	{
+		set<path> units;
+		for (const auto& file : files)
+			if (const auto id = this->find(file))
+				if (const auto it = m_dependents.find(*id); it != m_dependents.end())
+					for (const uint32_t unit : it->second)
+						units.insert(m_files[unit]);
+		return units;
+	}
+
+	bool IncludeGraph::contains(const path& file) const
+	{
+		const auto id = this->find(file);
+		return id && m_dependents.contains(*id);
+	}
+
+	path IncludeGraph::normalized(const path& file)
+	{
+		std::error_code ec;
+		const path p = std::filesystem::weakly_canonical(std::filesystem::absolute(file), ec);
+		return ec ? file.lexically_normal() : p;
+	}
+
+	uint32_t IncludeGraph::id(const path& file)
+	{
+		// clang reports the same header many times, the normalization touches the file system
+		const string raw = file.string();
+		if (const auto it = m_rawIds.find(raw); it != m_rawIds.end())
+			return it->second;
+
+		const string name = normalized(file).string();
+		auto [it, inserted] = m_ids.emplace(name, (uint32_t)m_files.size());
+		if (inserted)
+			m_files.push_back(name);
+		m_rawIds.emplace(raw, it->second);
+		return it->second;
+	}
+
+	optional<uint32_t> IncludeGraph::find(const path& file) const
+	{
+		if (const auto it = m_rawIds.find(file.string()); it != m_rawIds.end())
+			return it->second;
+		if (const auto it = m_ids.find(normalized(file).string()); it != m_ids.end())
+			return it->second;
+		return std::nullopt;
+	}
+}
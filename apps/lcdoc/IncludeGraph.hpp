@@ -0,0 +1,68 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <set>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <optional>
+
+#include "clang_interface/TranslationUnit.hpp"
+
+namespace lcdoc
+{
+	using std::string;
+	using std::vector;
+	using std::set;
+	using std::map;
+	using std::optional;
+	using std::filesystem::path;
+
+	// The #include graph of every translation unit of a project, as resolved by clang (clang_getInclusions).
+	// The edges are kept per unit, since the same header can resolve its includes differently with other
+	// options. It answers which units must be reparsed when some files change: those whose main file or
+	// included files are among them. All the paths are normalized (see normalized()).
+	class IncludeGraph
+	{
+	public:
+
+		// a missing or corrupted file gives an empty graph
+		static IncludeGraph load(const path& file);
+
+		void save(const path& file) const;
+
+		// replaces the #include edges of the unit whose main file is `unit`
+		void setUnit(const path& unit, const vector<clang::Inclusion>& inclusions);
+
+		void removeUnit(const path& unit);
+
+		// removes the units whose main file is not in `units`, e.g. after a change of the project
+		void retainUnits(const set<path>& units);
+
+		// the main files of the units that must be reparsed when `files` change
+		set<path> affectedUnits(const set<path>& files) const;
+
+		// true if `file` is the main file or an included file of some unit
+		bool contains(const path& file) const;
+
+		static path normalized(const path& file);
+
+	private:
+
+		uint32_t id(const path& file);
+		optional<uint32_t> find(const path& file) const;
+
+		// every file once, with the memo of the normalization of the paths reported by clang
+		vector<string> m_files;
+		std::unordered_map<string, uint32_t> m_ids;
+		std::unordered_map<string, uint32_t> m_rawIds;
+
+		// main file -> (includer, included) edges
+		map<uint32_t, vector<std::pair<uint32_t, uint32_t>>> m_units;
+
+		// file -> main files of the units depending on it
+		std::unordered_map<uint32_t, set<uint32_t>> m_dependents;
+	};
+}
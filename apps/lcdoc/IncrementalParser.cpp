@@ -0,0 +1,137 @@
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+
+#include "IncrementalParser.hpp"
+
+namespace lcdoc
+{
+	IncrementalParser::IncrementalParser(const shared_ptr<CXXProject>& project) :
+		m_project(project)
+	{
+	}
+
+	shared_ptr<ParsedCXXProject> IncrementalParser::parse()
+	{
+		m_units.clear();
+		m_graph = {};
+
+		if (!m_project)
+		{
+			m_parsed = std::make_shared<ParsedCXXProject>();
+			return m_parsed;
+		}
+
+		m_parser.backend = m_project->extraction;
+		m_parser.filter = m_project->extractionFilter;
+
+		// the first parse is the one of a normal run (jobs, cache, PCHs, extraction backend),
+		// the translation units are only created again by the first change that affects them
+		ParsedUnits parsedUnits;
+		m_parsed = lcdoc::parse(m_project, &parsedUnits);
+
+		// the edges of the units loaded from the cache are in the graph saved by parse()
+		if (!m_project->cacheDir.empty())
+			m_graph = IncludeGraph::load(m_project->cacheDir / "include_graph.lcdg");
+
+		const auto args = m_project->inputFilesArgs();
+		for (size_t i = 0; i < m_project->inputFiles.size(); ++i)
+		{
+			const auto& file = m_project->inputFiles[i];
+			Unit unit;
+			unit.file = file.path;
+			unit.args = args[i];
+			// the preamble is cached by clang, reparses after an edit of the main file are much faster
+			unit.flags = (file.options.parseMode | m_project->inputFilesOptions.parseMode).flags() | ::CXTranslationUnit_PrecompiledPreamble;
+			unit.registry = std::move(parsedUnits.registries[i]);
+			if (parsedUnits.inclusions[i])
+				m_graph.setUnit(unit.file, *parsedUnits.inclusions[i]);
+			m_units.push_back(std::move(unit));
+		}
+
+		return m_parsed;
+	}
+
+	bool IncrementalParser::isDependency(const path& file) const
+	{
+		return m_graph.contains(file);
+	}
+
+	size_t IncrementalParser::update(const set<path>& changedFiles)
+	{
+		if (!m_parsed)
+			return 0;
+
+		const auto start = std::chrono::steady_clock::now();
+
+		const set<path> affected = m_graph.affectedUnits(changedFiles);
+
+		// symbols contributed by the affected units, before and after the reparse
+		set<string> usrs;
+		size_t reparsed = 0;
+
+		for (auto& unit : m_units)
+		{
+			if (!affected.contains(IncludeGraph::normalized(unit.file)))
+				continue;
+
+			for (const auto& symbol : unit.registry.symbols)
+				usrs.insert(symbol->usr());
+
+			this->extract(unit);
+
+			for (const auto& symbol : unit.registry.symbols)
+				usrs.insert(symbol->usr());
+
+			++reparsed;
+		}
+
+		if (reparsed > 0)
+		{
+			m_parsed->registry.refresh(usrs, this->contributions());
+			m_parsed->freeze();
+			this->saveGraph();
+
+			const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+			std::cout << "reparsed " << reparsed << " translation units in " << elapsed.count() << "ms" << std::endl;
+		}
+
+		return reparsed;
+	}
+
+	void IncrementalParser::extract(Unit& unit)
+	{
+		m_parser.registry = {};
+		if (m_parser.backend == ExtractionBackend::Indexer)
+			// the indexer parses the file again, there is no unit to keep
+			m_parser.parse(unit.file, *unit.args, unit.flags);
+		else
+		{
+			if (!unit.TU || !unit.TU->reparse())
+				unit.TU = std::make_unique<clang::TranslationUnit>(m_parser.index(), unit.file, *unit.args, unit.flags);
+			m_parser.extract(*unit.TU);
+		}
+		unit.registry = std::move(m_parser.registry);
+
+		m_graph.setUnit(unit.file, m_parser.inclusions);
+	}
+
+	vector<const SymbolRegistry*> IncrementalParser::contributions() const
+	{
+		vector<const SymbolRegistry*> result;
+		result.reserve(m_units.size());
+		for (const auto& unit : m_units)
+			result.push_back(&unit.registry);
+		return result;
+	}
+
+	void IncrementalParser::saveGraph() const
+	{
+		if (!m_project || m_project->cacheDir.empty())
+			return;
+
+		std::error_code ec;
+		std::filesystem::create_directories(m_project->cacheDir, ec);
+		m_graph.save(m_project->cacheDir / "include_graph.lcdg");
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <set>
+#include <filesystem>
+
+#include "Project.hpp"
+#include "cxx_parser.hpp"
+#include "IncludeGraph.hpp"
+
+namespace lcdoc
+{
+	using std::shared_ptr;
+	using std::unique_ptr;
+	using std::vector;
+	using std::set;
+	using std::filesystem::path;
+
+	// Parser for the watch mode: the project is first parsed as in a normal run, then when a source or a header
+	// changes only the translation units that include it, according to the include graph, are parsed again and
+	// only their symbols are refreshed in the registry of the parsed project. The translation units are kept
+	// alive from their first reparse on, the next ones use clang_reparseTranslationUnit.
+	class IncrementalParser
+	{
+	public:
+
+		IncrementalParser(const shared_ptr<CXXProject>& project);
+
+		// parses all the input files, the returned project is updated in place by update()
+		shared_ptr<ParsedCXXProject> parse();
+
+		// true if `file` is a source or an included file of some translation unit
+		bool isDependency(const path& file) const;
+
+		// reparses the translation units affected by `changedFiles`, returns the number of reparsed units
+		size_t update(const set<path>& changedFiles);
+
+	private:
+
+		struct Unit
+		{
+			path file;
+			SharedArgs args;
+			unsigned flags = 0;
+			unique_ptr<clang::TranslationUnit> TU; // null until the first reparse, and with the indexer backend
+			SymbolRegistry registry;
+		};
+
+		void extract(Unit& unit);
+
+		vector<const SymbolRegistry*> contributions() const;
+
+		// saves the include graph next to the symbol cache, if any
+		void saveGraph() const;
+
+	private:
+		shared_ptr<CXXProject> m_project;
+		shared_ptr<ParsedCXXProject> m_parsed;
+		CXXDocumentParser m_parser;
+		vector<Unit> m_units;
+		IncludeGraph m_graph;
+	};
+}
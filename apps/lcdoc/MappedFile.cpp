@@ -0,0 +1,104 @@
+#include <stdexcept>
+
+#ifdef WIN32
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "MappedFile.hpp"
+
+namespace lcdoc
+{
+#ifdef WIN32
+
+	MappedFile::MappedFile(const path& file)
+	{
+		m_file = CreateFileW(file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (m_file == INVALID_HANDLE_VALUE)
+		{
+			m_file = nullptr;
+			throw std::runtime_error("cannot open " + file.string());
+		}
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(m_file, &size))
+		{
+			CloseHandle(m_file);
+			throw std::runtime_error("cannot get the size of " + file.string());
+		}
+		m_size = (size_t)size.QuadPart;
+
+		// an empty file cannot be mapped
+		if (m_size == 0)
+			return;
+
+		m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!m_mapping)
+		{
+			CloseHandle(m_file);
+			throw std::runtime_error("cannot map " + file.string());
+		}
+
+		m_data = static_cast<const std::byte*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+		if (!m_data)
+		{
+			CloseHandle(m_mapping);
+			CloseHandle(m_file);
+			throw std::runtime_error("cannot map " + file.string());
+		}
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (m_data)
+			UnmapViewOfFile(m_data);
+		if (m_mapping)
+			CloseHandle(m_mapping);
+		if (m_file)
+			CloseHandle(m_file);
+	}
+
+#else
+
+	MappedFile::MappedFile(const path& file)
+	{
+		const int fd = ::open(file.c_str(), O_RDONLY);
+		if (fd < 0)
+			throw std::runtime_error("cannot open " + file.string());
+
+		struct stat info;
+		if (::fstat(fd, &info) != 0)
+		{
+			::close(fd);
+			throw std::runtime_error("cannot get the size of " + file.string());
+		}
+		m_size = (size_t)info.st_size;
+
+		if (m_size > 0)
+		{
+			void* data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (data == MAP_FAILED)
+			{
+				::close(fd);
+				throw std::runtime_error("cannot map " + file.string());
+			}
+			m_data = static_cast<const std::byte*>(data);
+		}
+
+		// the mapping stays valid after the descriptor is closed
+		::close(fd);
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (m_data)
+			::munmap(const_cast<std::byte*>(m_data), m_size);
+	}
+
+#endif
+}
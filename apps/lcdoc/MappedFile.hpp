@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace lcdoc
+{
+	using std::filesystem::path;
+
+	// read-only memory mapping of a whole file
+	class MappedFile
+	{
+	public:
+
+		// throws std::runtime_error if the file cannot be mapped
+		explicit MappedFile(const path& file);
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		~MappedFile();
+
+		std::span<const std::byte> bytes() const { return { m_data, m_size }; }
+
+	private:
+		const std::byte* m_data = nullptr;
+		size_t m_size = 0;
+
+#ifdef WIN32
+		void* m_file = nullptr;
+		void* m_mapping = nullptr;
+#endif
+	};
+}
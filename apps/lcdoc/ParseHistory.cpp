@@ -0,0 +1,140 @@
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <numeric>
+
+#include "binary_io.hpp"
+
+#include "ParseHistory.hpp"
+
+namespace lcdoc
+{
+	namespace
+	{
+		constexpr uint32_t history_magic = 0x4844434c; // "LCDH"
+		constexpr uint32_t history_version = 1;
+
+		// the average parse time of the known sources, used for the ones never parsed before
+		double average_seconds(const vector<optional<ParseCost>>& costs)
+		{
+			double sum = 0;
+			size_t known = 0;
+			for (const auto& cost : costs)
+				if (cost)
+				{
+					sum += cost->seconds;
+					++known;
+				}
+			return known > 0 ? sum / known : 0;
+		}
+	}
+
+	ParseHistory::ParseHistory(const path& file) :
+		m_file(file)
+	{
+		std::ifstream in(file, std::ios::binary);
+		if (!in)
+			return;
+
+		try
+		{
+			BinaryReader r(in);
+			if (r.u32() != history_magic || r.u32() != history_version)
+				return;
+
+			for (uint32_t n = r.u32(); n > 0; --n)
+			{
+				string source = r.str();
+				ParseCost cost;
+				cost.seconds = (double)r.u64() / 1e6;
+				cost.memory = r.u64();
+				m_costs.emplace(std::move(source), cost);
+			}
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << "ignoring corrupted parse history " << file << ": " << e.what() << std::endl;
+			m_costs.clear();
+		}
+	}
+
+	optional<ParseCost> ParseHistory::cost(const path& source) const
+	{
+		std::lock_guard lock(m_mutex);
+		const auto it = m_costs.find(key(source));
+		if (it == m_costs.end())
+			return std::nullopt;
+		return it->second;
+	}
+
+	void ParseHistory::record(const path& source, const ParseCost& cost)
+	{
+		std::lock_guard lock(m_mutex);
+		m_costs[key(source)] = cost;
+	}
+
+	void ParseHistory::save() const
+	{
+		// written to a temporary file and renamed, so that an interrupted run keeps the previous history
+		path tmp = m_file;
+		tmp += ".tmp";
+		{
+			std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+			BinaryWriter w(out);
+
+			w.u32(history_magic);
+			w.u32(history_version);
+
+			std::lock_guard lock(m_mutex);
+			w.u32((uint32_t)m_costs.size());
+			for (const auto& [source, cost] : m_costs)
+			{
+				w.str(source);
+				w.u64((uint64_t)(cost.seconds * 1e6));
+				w.u64(cost.memory);
+			}
+
+			if (!out)
+			{
+				std::cerr << "could not write the parse history " << m_file << std::endl;
+				return;
+			}
+		}
+
+		std::error_code ec;
+		std::filesystem::rename(tmp, m_file, ec);
+		if (ec)
+			std::filesystem::remove(tmp, ec);
+	}
+
+	vector<size_t> ParseHistory::longestFirst(const vector<path>& sources) const
+	{
+		vector<optional<ParseCost>> costs;
+		for (const auto& source : sources)
+			costs.push_back(this->cost(source));
+		const double unknown = average_seconds(costs);
+
+		vector<size_t> order(sources.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+			return (costs[a] ? costs[a]->seconds : unknown) > (costs[b] ? costs[b]->seconds : unknown);
+		});
+		return order;
+	}
+
+	vector<optional<uint64_t>> ParseHistory::memoryEstimates(const vector<path>& sources) const
+	{
+		vector<optional<uint64_t>> estimates;
+		for (const auto& source : sources)
+			if (const auto cost = this->cost(source))
+				estimates.push_back(cost->memory);
+			else
+				estimates.push_back(std::nullopt);
+		return estimates;
+	}
+
+	string ParseHistory::key(const path& source)
+	{
+		return std::filesystem::absolute(source).lexically_normal().string();
+	}
+}
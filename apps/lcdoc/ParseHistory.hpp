@@ -0,0 +1,58 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <map>
+#include <mutex>
+#include <optional>
+
+namespace lcdoc
+{
+	using std::string;
+	using std::vector;
+	using std::map;
+	using std::optional;
+	using std::filesystem::path;
+
+	// what parsing a translation unit costs
+	struct ParseCost
+	{
+		double seconds = 0;
+		uint64_t memory = 0; // bytes reported by clang_getCXTUResourceUsage
+	};
+
+	// The parse cost of every translation unit in the previous runs, kept in the cache directory.
+	// It is used to schedule the longest units first and to estimate their memory.
+	// record() can be called from several threads at once.
+	class ParseHistory
+	{
+	public:
+
+		// loads `file` if it exists, a corrupted history is ignored
+		explicit ParseHistory(const path& file);
+
+		// the cost of `source` in the last run that parsed it
+		optional<ParseCost> cost(const path& source) const;
+
+		void record(const path& source, const ParseCost& cost);
+
+		// writes the history back to its file
+		void save() const;
+
+		// the input files sorted by decreasing parse time, the unknown ones are assumed to take the average time
+		vector<size_t> longestFirst(const vector<path>& sources) const;
+
+		// the recorded memory of each input file, nullopt for the files never parsed
+		vector<optional<uint64_t>> memoryEstimates(const vector<path>& sources) const;
+
+	private:
+
+		static string key(const path& source);
+
+		path m_file;
+
+		mutable std::mutex m_mutex;
+		map<string, ParseCost> m_costs;
+	};
+}
@@ -0,0 +1,196 @@
+#include <fstream>
+#include <chrono>
+#include <format>
+#include <algorithm>
+
+#include "clang_interface/TranslationUnit.hpp"
+#include "hash.hpp"
+#include "string_utils.hpp"
+
+#include "PrecompiledHeaders.hpp"
+
+namespace lcdoc
+{
+	PrecompiledHeaders::PrecompiledHeaders(const CXXProject& project, const vector<SharedArgs>& args, const path& dir) :
+		m_dir(dir)
+	{
+		// group by identical arguments, in input order: the interned lists are compared by pointer
+		map<const vector<string>*, vector<size_t>> byArgs;
+		vector<SharedArgs> order;
+		for (size_t i = 0; i < args.size(); ++i)
+		{
+			auto [it, inserted] = byArgs.try_emplace(args[i].get());
+			if (inserted)
+				order.push_back(args[i]);
+			it->second.push_back(i);
+		}
+
+		for (const auto& groupArgs : order)
+		{
+			const auto& files = byArgs[groupArgs.get()];
+			if (files.size() < 2)
+				continue;
+
+			// longest common prefix of the leading includes
+			vector<string> prefix = leadingIncludes(project.inputFiles[files.front()].path);
+			for (size_t i = 1; i < files.size() && !prefix.empty(); ++i)
+			{
+				const auto includes = leadingIncludes(project.inputFiles[files[i]].path);
+				const auto [end, _] = std::mismatch(prefix.begin(), prefix.end(), includes.begin(), includes.end());
+				prefix.erase(end, prefix.end());
+			}
+
+			if (prefix.empty())
+				continue;
+
+			auto group = std::make_unique<Group>();
+			group->files = files;
+			group->args = groupArgs;
+			group->prefix = std::move(prefix);
+
+			uint64_t key = hash_bytes(join(group->prefix, "\n"));
+			for (const auto& arg : *group->args)
+				key = hash_combine(key, hash_bytes(arg));
+			group->target = m_dir / (to_hex(key) + ".pch");
+
+			for (const size_t file : files)
+				m_groupOf[file] = group.get();
+			m_groups.push_back(std::move(group));
+		}
+	}
+
+	vector<string> PrecompiledHeaders::argsFor(size_t file, const clang::Index& index)
+	{
+		const auto it = m_groupOf.find(file);
+		if (it == m_groupOf.end())
+			return {};
+
+		Group& group = *it->second;
+		std::call_once(group.built, [&]() { this->build(group, index); });
+
+		if (group.pch.empty())
+			return {};
+		return { "-include-pch", group.pch.string() };
+	}
+
+	vector<string> PrecompiledHeaders::expectedArgsFor(size_t file) const
+	{
+		const auto it = m_groupOf.find(file);
+		if (it == m_groupOf.end())
+			return {};
+		return { "-include-pch", it->second->target.string() };
+	}
+
+	vector<path> PrecompiledHeaders::inclusionsFor(size_t file) const
+	{
+		const auto it = m_groupOf.find(file);
+		if (it == m_groupOf.end())
+			return {};
+		return it->second->inclusions;
+	}
+
+	void PrecompiledHeaders::addParseTime(size_t file, double seconds)
+	{
+		const auto it = m_groupOf.find(file);
+		if (it == m_groupOf.end())
+			return;
+
+		std::lock_guard lock(m_mutex);
+		it->second->parseSeconds += seconds;
+		it->second->parsedFiles++;
+	}
+
+	void PrecompiledHeaders::report(std::ostream& out) const
+	{
+		std::lock_guard lock(m_mutex);
+		for (size_t i = 0; i < m_groups.size(); ++i)
+		{
+			const Group& group = *m_groups[i];
+			if (group.pch.empty() || group.parsedFiles == 0)
+				continue;
+
+			// not measured: assumes that without the PCH every unit would have parsed the common headers
+			// again, in the time it took to build the PCH
+			const double saved = (double)(group.parsedFiles - 1) * group.buildSeconds;
+			out << std::format(
+				"pch group {}: {} files, {} common includes, built in {:.2f}s, {:.2f}s parsing, estimated {:.2f}s saved ((files - 1) x build time)",
+				i, group.parsedFiles, group.prefix.size(), group.buildSeconds, group.parseSeconds, saved
+			) << std::endl;
+		}
+	}
+
+	void PrecompiledHeaders::build(Group& group, const clang::Index& index)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		std::filesystem::create_directories(m_dir);
+		const path header = path(group.target).replace_extension(".hpp");
+		const path& pch = group.target;
+
+		{
+			std::ofstream out(header);
+			for (const auto& include : group.prefix)
+				out << include << "\n";
+		}
+
+		clang::TranslationUnit TU(index, header, *group.args | vector<string>{ "-x", "c++-header" }, ::CXTranslationUnit_Incomplete | ::CXTranslationUnit_ForSerialization);
+		if (TU && TU.save(pch))
+		{
+			group.pch = pch;
+			group.inclusions = TU.inclusions();
+		}
+
+		group.buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	vector<string> PrecompiledHeaders::leadingIncludes(const path& file)
+	{
+		vector<string> includes;
+
+		std::ifstream in(file);
+		string line;
+		bool inComment = false;
+		while (std::getline(in, line))
+		{
+			// trim
+			const auto begin = line.find_first_not_of(" \t\r");
+			if (begin == string::npos)
+				continue;
+			line = line.substr(begin, line.find_last_not_of(" \t\r") - begin + 1);
+
+			if (inComment)
+			{
+				inComment = line.find("*/") == string::npos;
+				continue;
+			}
+			if (line.starts_with("//") || line == "#pragma once")
+				continue;
+			if (line.starts_with("/*"))
+			{
+				inComment = line.find("*/") == string::npos;
+				continue;
+			}
+
+			if (!line.starts_with("#"))
+				break;
+			const auto directive = line.find_first_not_of(" \t", 1);
+			if (directive == string::npos || line.compare(directive, 7, "include") != 0)
+				break;
+
+			// quoted includes are relative to the including file, they are made absolute so that they
+			// mean the same thing for every file of the group and in the generated header
+			const auto open = line.find('"');
+			const auto close = open == string::npos ? string::npos : line.find('"', open + 1);
+			if (close != string::npos)
+			{
+				const path relative = file.parent_path() / line.substr(open + 1, close - open - 1);
+				if (std::filesystem::exists(relative))
+					line = std::format("#include \"{}\"", std::filesystem::absolute(relative).lexically_normal().generic_string());
+			}
+
+			includes.push_back(line);
+		}
+
+		return includes;
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <ostream>
+
+#include "clang_interface/Index.hpp"
+#include "Project.hpp"
+#include "ArgumentPool.hpp"
+
+namespace lcdoc
+{
+	using std::string;
+	using std::vector;
+	using std::map;
+	using std::unique_ptr;
+	using std::filesystem::path;
+
+	// Shares the parsing of the common headers between translation units.
+	// The input files with identical compilation options are grouped, and for every group whose
+	// files start with the same #include directives a PCH of those includes is built (once, by the
+	// first translation unit that needs it) and passed to all the units of the group with -include-pch.
+	// The declarations coming from the PCH are then skipped by the index (excludeDeclsFromPCH), so the PCHs
+	// are only used when the declarations of the headers are not extracted (ExtractionFilter::mainFileOnly).
+	class PrecompiledHeaders
+	{
+	public:
+
+		// `args` are the clang arguments of each input file, interned: the files with the same arguments
+		// share them. `dir` is where the PCHs are written
+		PrecompiledHeaders(const CXXProject& project, const vector<SharedArgs>& args, const path& dir);
+
+		// the additional clang arguments for the input file `file`, builds the PCH of its group if needed
+		vector<string> argsFor(size_t file, const clang::Index& index);
+
+		// what argsFor() returns once the PCH of `file` is built, without building it: keys the symbol cache
+		vector<string> expectedArgsFor(size_t file) const;
+
+		// the files included by the PCH of `file`, libclang does not report them among the inclusions of the unit
+		vector<path> inclusionsFor(size_t file) const;
+
+		// records the time spent parsing `file` with its PCH
+		void addParseTime(size_t file, double seconds);
+
+		// prints the time spent for each group, and an estimate of the time saved
+		void report(std::ostream& out) const;
+
+	private:
+
+		struct Group
+		{
+			vector<size_t> files;
+			SharedArgs args;
+			vector<string> prefix; // the common #include directives
+			path target; // where the PCH is written, named after the prefix and the arguments
+
+			std::once_flag built;
+			path pch; // empty if the PCH could not be built
+			vector<path> inclusions;
+			double buildSeconds = 0;
+			double parseSeconds = 0;
+			size_t parsedFiles = 0;
+		};
+
+		void build(Group& group, const clang::Index& index);
+
+		// the leading #include directives of a source file, quoted includes are made absolute
+		static vector<string> leadingIncludes(const path& file);
+
+	private:
+		path m_dir;
+		vector<unique_ptr<Group>> m_groups;
+		map<size_t, Group*> m_groupOf;
+		mutable std::mutex m_mutex;
+	};
+}
@@ -1,9 +1,21 @@
 
 #include <fstream>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <functional>
 
 #include "Project.hpp"
 
 #include "cxx_parser.hpp"
+#include "SymbolCache.hpp"
+#include "PrecompiledHeaders.hpp"
+#include "worker_pool.hpp"
+#include "ParseHistory.hpp"
+#include "TaskScheduler.hpp"
+#include "memory_usage.hpp"
+#include "IncludeGraph.hpp"
 
 // !!!
 #include <iostream>
@@ -18,21 +30,356 @@ using namespace std::string_literals;
 namespace lcdoc
 {
 	using std::make_shared;
+	using std::make_unique;
+	using std::unique_ptr;
 
-	shared_ptr<ParsedCXXProject> parse(const shared_ptr<CXXProject>& project)
+	namespace
+	{
+		unsigned effectiveJobs(unsigned requested, size_t nFiles)
+		{
+			unsigned jobs = requested;
+			if (jobs == 0)
+				jobs = std::max(1u, std::thread::hardware_concurrency());
+			return (unsigned)std::max<size_t>(1, std::min<size_t>(jobs, nFiles));
+		}
+
+		// runs `worker` on `jobs` threads, `stop` is called on the first exception, which is rethrown once all the threads are over
+		void run_threads(unsigned jobs, const std::function<void()>& worker, const std::function<void()>& stop)
+		{
+			if (jobs <= 1)
+			{
+				worker();
+				return;
+			}
+
+			vector<std::exception_ptr> errors(jobs);
+			{
+				vector<std::jthread> workers;
+				for (unsigned i = 0; i < jobs; ++i)
+					workers.emplace_back([&, i]() {
+						try
+						{
+							worker();
+						}
+						catch (...)
+						{
+							errors[i] = std::current_exception();
+							stop();
+						}
+					});
+			}
+
+			for (const auto& error : errors)
+				if (error)
+					std::rethrow_exception(error);
+		}
+	}
+
+	vector<SharedArgs> CXXProject::inputFilesArgs()
+	{
+		const auto projectOptions = this->inputFilesOptions.options();
+
+		vector<SharedArgs> args;
+		args.reserve(this->inputFiles.size());
+		for (const auto& file : this->inputFiles)
+		{
+			// the options of the project come last, they override the ones of the compilation database
+			vector<string> fileArgs = projectOptions | file.options.options();
+			if (file.compileArgs)
+				fileArgs = *file.compileArgs | std::move(fileArgs);
+			args.push_back(this->arguments.intern(std::move(fileArgs)));
+		}
+		return args;
+	}
+
+	shared_ptr<ParsedCXXProject> parse(const shared_ptr<CXXProject>& project, ParsedUnits* units)
 	{
 		if (!project)
 			return nullptr;
 
 		auto parsed = make_shared<ParsedCXXProject>();
-		CXXDocumentParser parser;
 
-		const auto projectOptions = project->inputFilesOptions.options();
+		const auto& files = project->inputFiles;
+
+		// the files with the same flags share their argument list
+		const vector<SharedArgs> args = project->inputFilesArgs();
+		if (!project->compilationDatabase.empty())
+		{
+			// the pool also holds the lists of the database before the options of the project were added
+			set<const vector<string>*> distinct;
+			for (const auto& fileArgs : args)
+				distinct.insert(fileArgs.get());
+			std::cout << files.size() << " files, " << distinct.size() << " distinct argument lists" << std::endl;
+		}
+
+		// every translation unit is parsed in its own registry, the registries are then merged
+		// as in the input order so that the result does not depend on the number of jobs
+		vector<SymbolRegistry> registries(files.size());
+		vector<char> ready(files.size(), false);
+
+		// the #include edges of the parsed units, for the include graph
+		vector<optional<vector<clang::Inclusion>>> inclusions(files.size());
+
+		// the registries are moved into the merge, the caller gets copies. Each unit is kept by a single thread
+		if (units)
+			units->registries = vector<SymbolRegistry>(files.size());
+		const auto keepUnit = [&](size_t i, const SymbolRegistry& registry) {
+			if (units)
+				units->registries[i].merge(registry);
+		};
+
+		unique_ptr<SymbolCache> cache;
+		unique_ptr<ParseHistory> history;
+		if (!project->cacheDir.empty())
+		{
+			cache = make_unique<SymbolCache>(project->cacheDir, project->extractionFilter.hash());
+			history = make_unique<ParseHistory>(project->cacheDir / "parse_history.lcdh");
+		}
+		std::atomic<size_t> cacheHits = 0;
+
+		// the index skips the declarations of a PCH, those of the headers extracted by the include rules among them
+		unique_ptr<PrecompiledHeaders> pch;
+		if (project->precompiledHeaders && !project->extractionFilter.mainFileOnly())
+			std::cerr << "precompiledHeaders is ignored: the extract path rules need the declarations of the headers" << std::endl;
+		else if (project->precompiledHeaders)
+		{
+			const path pchDir = project->cacheDir.empty() ? std::filesystem::temp_directory_path() / "lcdoc-pch" : project->cacheDir / "pch";
+			pch = make_unique<PrecompiledHeaders>(*project, args, pchDir);
+		}
+
+		const auto flagsOf = [&](size_t i) {
+			return (files[i].options.parseMode | project->inputFilesOptions.parseMode).flags();
+		};
+
+		// a unit parsed with a PCH is cached under the PCH arguments, the PCH is not built to look it up
+		const auto cacheArgsOf = [&](size_t i) {
+			return pch ? *args[i] | pch->expectedArgsFor(i) : *args[i];
+		};
+
+		// the cached units are loaded first, only the others are scheduled
+		if (cache)
+		{
+			MemoryPhase phase("loading the symbol cache");
+			std::atomic<size_t> next = 0;
+			run_threads(
+				effectiveJobs(project->jobs, files.size()),
+				[&]() {
+					for (size_t i = next++; i < files.size(); i = next++)
+						if (auto cached = cache->load(files[i].path, cacheArgsOf(i), flagsOf(i)))
+						{
+							registries[i] = std::move(*cached);
+							keepUnit(i, registries[i]);
+							ready[i] = true;
+							++cacheHits;
+						}
+				},
+				[&]() { next = files.size(); }
+			);
+		}
+
+		vector<size_t> toParse;
+		for (size_t i = 0; i < files.size(); ++i)
+			if (!ready[i])
+				toParse.push_back(i);
+
+		// the longest units first, so that none of them is left alone at the end of the run
+		vector<size_t> order = toParse;
+		vector<optional<uint64_t>> memory(files.size());
+		if (history)
+		{
+			vector<path> sources;
+			for (const size_t i : toParse)
+				sources.push_back(files[i].path);
+
+			const auto longest = history->longestFirst(sources);
+			const auto estimates = history->memoryEstimates(sources);
+			for (size_t k = 0; k < toParse.size(); ++k)
+			{
+				order[k] = toParse[longest[k]];
+				memory[toParse[k]] = estimates[k];
+			}
+		}
+
+		// the units with the same flags are alike, their memory estimates are shared
+		vector<uint32_t> groups(files.size());
+		{
+			map<const vector<string>*, uint32_t> groupOf;
+			for (size_t i = 0; i < files.size(); ++i)
+				groups[i] = groupOf.emplace(args[i].get(), (uint32_t)groupOf.size()).first->second;
+		}
+		TaskScheduler scheduler(order, std::move(memory), project->maxParseMemory, std::move(groups));
+
+		const auto parseUnit = [&](CXXDocumentParser& parser, size_t i) -> ParsedUnit {
+			const auto flags = flagsOf(i);
+			const auto start = std::chrono::steady_clock::now();
+
+			parser.registry = {};
+			parser.backend = project->extraction;
+			parser.filter = project->extractionFilter;
+			vector<string> pchArgs;
+			if (pch)
+			{
+				pchArgs = pch->argsFor(i, parser.index());
+				parser.parse(files[i].path, *args[i] | pchArgs, flags);
+				// the headers of the PCH are seen as included by the main file
+				for (auto& file : pch->inclusionsFor(i))
+				{
+					parser.inclusions.push_back({ files[i].path, file });
+					parser.includedFiles.push_back(std::move(file));
+				}
+			}
+			else
+				parser.parse(files[i].path, *args[i], flags);
+
+			const ParseCost cost{ std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), parser.memoryUsage };
+
+			if (cache)
+				cache->store(files[i].path, *args[i] | pchArgs, flags, parser.registry, parser.includedFiles);
+
+			return { std::move(parser.registry), cost, std::move(parser.inclusions) };
+		};
+
+		// called in this process: with isolated parsing, parseUnit() runs in a worker
+		const auto recordCost = [&](size_t i, const ParseCost& cost) {
+			if (history)
+				history->record(files[i].path, cost);
+			if (pch)
+				pch->addParseTime(i, cost.seconds);
+		};
+
+		if (project->isolatedParsing && !worker_pool_supported())
+			std::cerr << "isolated parsing is not supported on this platform, parsing in threads" << std::endl;
+
+		if (project->isolatedParsing && worker_pool_supported())
+		{
+			MemoryPhase phase("parsing and merging in workers");
+
+			// the PCHs are built before forking, so that all the workers share them
+			if (pch && !toParse.empty())
+			{
+				CXXDocumentParser parser;
+				for (const size_t i : toParse)
+					pch->argsFor(i, parser.index());
+			}
+
+			// the results are merged while the workers run, still in the input order
+			size_t merged = 0;
+			const auto mergeReady = [&]() {
+				for (; merged < files.size() && ready[merged]; ++merged)
+					parsed->registry.merge(std::move(registries[merged]));
+			};
+			mergeReady();
+
+			// created in each worker process by its first task
+			optional<CXXDocumentParser> workerParser;
 
-		for (const auto& file : project->inputFiles)
-			parser.parse(file.path, projectOptions | file.options.options());
+			size_t failed = 0;
+			run_in_workers(
+				scheduler,
+				{
+					.workers = effectiveJobs(project->jobs, toParse.size()),
+					.timeout = std::chrono::seconds(project->parseTimeout),
+					.retries = project->parseRetries,
+					.name = [&](size_t i) { return files[i].path; },
+				},
+				[&](size_t i) {
+					if (!workerParser)
+						workerParser.emplace();
+					return parseUnit(*workerParser, i);
+				},
+				[&](size_t i, optional<ParsedUnit>&& unit) {
+					if (unit)
+					{
+						recordCost(i, unit->cost);
+						inclusions[i] = std::move(unit->inclusions);
+						registries[i] = std::move(unit->registry);
+						keepUnit(i, registries[i]);
+					}
+					else
+						++failed;
+					ready[i] = true;
+					mergeReady();
+				}
+			);
+			mergeReady();
+
+			if (failed > 0)
+				std::cerr << failed << "/" << files.size() << " translation units could not be parsed" << std::endl;
+		}
+		else
+		{
+			// each unit is merged as soon as it is available, the symbols of the shared headers are then kept once
+			ConcurrentSymbolRegistry merged;
+			{
+				MemoryPhase phase("parsing");
+				vector<size_t> cached;
+				for (size_t i = 0; i < files.size(); ++i)
+					if (ready[i])
+						cached.push_back(i);
+				std::atomic<size_t> nextCached = 0;
+
+				run_threads(
+					effectiveJobs(project->jobs, files.size()),
+					[&]() {
+						for (size_t k = nextCached++; k < cached.size(); k = nextCached++)
+							merged.merge((uint32_t)cached[k], std::move(registries[cached[k]]));
+
+						// each worker has its own CXIndex
+						CXXDocumentParser parser;
+						while (const auto i = scheduler.next())
+						{
+							auto unit = parseUnit(parser, *i);
+							recordCost(*i, unit.cost);
+							inclusions[*i] = std::move(unit.inclusions);
+							scheduler.finish(*i, unit.cost.memory);
+							keepUnit(*i, unit.registry);
+							merged.merge((uint32_t)*i, std::move(unit.registry));
+						}
+					},
+					[&]() {
+						scheduler.cancel();
+						nextCached = cached.size();
+					}
+				);
+			}
+
+			MemoryPhase phase("merging");
+			parsed->registry = merged.collect();
+		}
+
+		if (history)
+			history->save();
+
+		// the units loaded from the cache did not change, their edges are still the ones on disk
+		if (!project->cacheDir.empty())
+		{
+			const path graphFile = project->cacheDir / "include_graph.lcdg";
+			auto graph = IncludeGraph::load(graphFile);
+			set<path> units;
+			for (size_t i = 0; i < files.size(); ++i)
+			{
+				units.insert(files[i].path);
+				if (inclusions[i])
+					graph.setUnit(files[i].path, *inclusions[i]);
+			}
+			graph.retainUnits(units);
+			graph.save(graphFile);
+		}
+
+		if (units)
+			units->inclusions = std::move(inclusions);
+
+		if (pch)
+			pch->report(std::cout);
+
+		if (cache)
+			std::cout << cacheHits << "/" << files.size() << " translation units loaded from the cache" << std::endl;
+
+		{
+			MemoryPhase phase("freezing");
+			parsed->freeze();
+		}
 
-		parsed->registry = std::move(parser.registry);
 		parsed->project = project;
 		return parsed;
 	}
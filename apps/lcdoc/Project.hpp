@@ -13,6 +13,10 @@
 #include <inja/inja.hpp>
 #include "string_utils.hpp"
 #include "Symbol.hpp"
+#include "FrozenRegistry.hpp"
+#include "ProjectIndex.hpp"
+#include "cxx_parser.hpp"
+#include "ArgumentPool.hpp"
 
 namespace lcdoc
 {
@@ -26,6 +30,48 @@ namespace lcdoc
 	using std::weak_ptr;
 	using std::optional;
 
+	// libclang parse flags (see CXTranslationUnit_Flags), the unset ones are inherited
+	struct CXXParseMode
+	{
+		optional<bool> skipFunctionBodies = {};
+		optional<bool> limitSkipFunctionBodiesToPreamble = {};
+		optional<bool> incomplete = {};
+		optional<bool> keepGoing = {};
+		optional<bool> detailedPreprocessingRecord = {};
+
+		// function bodies are skipped and errors do not stop the parse, enough for the declarations we document
+		static CXXParseMode declarations() {
+			return { .skipFunctionBodies = true, .keepGoing = true, .detailedPreprocessingRecord = false };
+		}
+
+		// the values of `this` with the unset ones taken from `fallback`
+		CXXParseMode operator|(const CXXParseMode& fallback) const {
+			CXXParseMode result = *this;
+			if (!result.skipFunctionBodies) result.skipFunctionBodies = fallback.skipFunctionBodies;
+			if (!result.limitSkipFunctionBodiesToPreamble) result.limitSkipFunctionBodiesToPreamble = fallback.limitSkipFunctionBodiesToPreamble;
+			if (!result.incomplete) result.incomplete = fallback.incomplete;
+			if (!result.keepGoing) result.keepGoing = fallback.keepGoing;
+			if (!result.detailedPreprocessingRecord) result.detailedPreprocessingRecord = fallback.detailedPreprocessingRecord;
+			return result;
+		}
+
+		unsigned flags() const {
+			unsigned flags = ::CXTranslationUnit_None;
+			if (this->skipFunctionBodies.value_or(false))
+				flags |= ::CXTranslationUnit_SkipFunctionBodies;
+			if (this->limitSkipFunctionBodiesToPreamble.value_or(false))
+				flags |= ::CXTranslationUnit_LimitSkipFunctionBodiesToPreamble;
+			if (this->incomplete.value_or(false))
+				flags |= ::CXTranslationUnit_Incomplete;
+			if (this->keepGoing.value_or(false))
+				flags |= ::CXTranslationUnit_KeepGoing;
+			// on by default, as clang_createTranslationUnitFromSourceFile did
+			if (this->detailedPreprocessingRecord.value_or(true))
+				flags |= ::CXTranslationUnit_DetailedPreprocessingRecord;
+			return flags;
+		}
+	};
+
 	struct CXXFileOptions
 	{
 		string standard;// = "c++20";
@@ -33,6 +79,7 @@ namespace lcdoc
 		map<string, string> additionalDefinitions;
 		set<string> undefines;
 		vector<string> additionalOptions;
+		CXXParseMode parseMode;
 
 		// see https://clang.llvm.org/docs/ClangCommandLineReference.html
 		vector<string> options() const {
@@ -64,6 +111,9 @@ namespace lcdoc
 	{
 		string path;
 		CXXFileOptions options;
+
+		// the arguments of the file in the compilation database, before the options of the project, null if none
+		SharedArgs compileArgs;
 	};
 
 	class CXXProject
@@ -76,12 +126,49 @@ namespace lcdoc
 		vector<CXXInputSourceFile> inputFiles;
 		CXXFileOptions inputFilesOptions;
 
+		// the build directory whose compile_commands.json adds its files to inputFiles, empty if none
+		path compilationDatabase;
+
+		// the argument lists of the files, shared between the files with the same ones
+		ArgumentPool arguments;
+
+		// the clang arguments of every input file, interned in `arguments`
+		vector<SharedArgs> inputFilesArgs();
+
 		path inputDir = path(LCDOC_SOURCE_DIR) / "example" / "doc_src";
 		path outDir = "./out2";
 		set<pair<path, path>> additionalMaterial; // TODO https://stackoverflow.com/questions/1902681/expand-file-names-that-have-environment-variables-in-their-path
 
 		map<string, path> models;
 
+		// number of translation units parsed in parallel, 0 means one per hardware thread
+		unsigned jobs = 1;
+
+		// directory of the symbol cache, empty to disable the cache
+		path cacheDir;
+
+		// share a PCH of the common headers between the files with the same options
+		bool precompiledHeaders = false;
+
+		// estimated memory of the translation units parsed at once, 0 for no limit. The estimates come from the
+		// parse history in cacheDir and from the units already parsed in the run
+		uint64_t maxParseMemory = 0;
+
+		// how the symbols are extracted from the translation units
+		ExtractionBackend extraction = ExtractionBackend::Cursors;
+
+		// the declarations extracted from the translation units
+		ExtractionFilter extractionFilter;
+
+		// parse in forked worker processes, so that a crash of libclang costs only its translation unit (POSIX only)
+		bool isolatedParsing = false;
+
+		// seconds an isolated worker may spend on a translation unit before it is killed, 0 for no limit
+		unsigned parseTimeout = 0;
+
+		// attempts of a translation unit after its isolated worker crashed or timed out
+		unsigned parseRetries = 1;
+
 	private:
 
 	};
@@ -92,12 +179,36 @@ namespace lcdoc
 
 		weak_ptr<CXXProject> project;
 
+		// modified while parsing only
 		SymbolRegistry registry;
 
+		// read-only snapshot of `registry` for the renderers, rebuilt by freeze()
+		shared_ptr<const FrozenRegistry> frozen;
+
+		void freeze() {
+			// the comments are read from the sources as they are now
+			forget_comment_sources();
+			this->frozen = std::make_shared<const FrozenRegistry>(this->registry);
+		}
+
+		// set instead of `registry` and `frozen` when the project is loaded from a .lcdx index
+		shared_ptr<const ProjectIndex> index;
+
 	private:
 	};
 
-	shared_ptr<ParsedCXXProject> parse(const shared_ptr<CXXProject>& project);
+	// what parse() keeps of every translation unit, for the watch mode
+	struct ParsedUnits
+	{
+		// a copy of the registry of each input file, before the merge
+		vector<SymbolRegistry> registries;
+		// the #include edges of each input file, nullopt for the units loaded from the cache
+		vector<optional<vector<clang::Inclusion>>> inclusions;
+	};
+
+	// parses all the input files of the project. If `units` is given, it receives the registries and the
+	// #include edges of the translation units
+	shared_ptr<ParsedCXXProject> parse(const shared_ptr<CXXProject>& project, ParsedUnits* units = nullptr);
 
 	// TODO sposta
 	string read2str(std::istream& in);
@@ -0,0 +1,339 @@
+#include <fstream>
+#include <algorithm>
+#include <unordered_map>
+#include <map>
+#include <stdexcept>
+#include <type_traits>
+
+#include "ProjectIndex.hpp"
+#include "hash.hpp"
+
+namespace
+{
+	using namespace lcdoc;
+	using namespace lcdoc::lcdx;
+
+	static_assert(std::is_trivially_copyable_v<Header>);
+	static_assert(std::is_trivially_copyable_v<SymbolRecord>);
+	static_assert(std::is_trivially_copyable_v<LocationRecord>);
+	static_assert(std::is_trivially_copyable_v<TypeRecord>);
+	static_assert(std::is_trivially_copyable_v<ArgRecord>);
+	static_assert(std::is_trivially_copyable_v<FileRecord>);
+
+	constexpr uint64_t section_alignment = 8;
+
+	class IndexWriter
+	{
+	public:
+
+		explicit IndexWriter(const FrozenRegistry& registry) : m_registry(registry) {}
+
+		vector<char> strings;
+		vector<SymbolRecord> symbols;
+		vector<uint32_t> children;
+		vector<uint32_t> roots;
+		vector<LocationRecord> locations;
+		vector<TypeRecord> types;
+		vector<ArgRecord> args;
+		vector<uint32_t> kindOffsets;
+		vector<uint32_t> byKind;
+		vector<FileRecord> files;
+		vector<uint32_t> byFile;
+
+		// every string is stored once
+		StrRef str(std::string_view value) {
+			if (auto it = m_strings.find(string(value)); it != m_strings.end())
+				return it->second;
+			if (this->strings.size() + value.size() > UINT32_MAX)
+				throw std::runtime_error("the index is too large");
+			const StrRef ref{ (uint32_t)this->strings.size(), (uint32_t)value.size() };
+			this->strings.insert(this->strings.end(), value.begin(), value.end());
+			m_strings.emplace(string(value), ref);
+			return ref;
+		}
+
+		uint32_t symbol(const Symbol* symbol) {
+			return symbol ? m_registry.indexOf(symbol->usr()) : none;
+		}
+
+		// the referenced types are written before the types referencing them
+		uint32_t type(const Type* type) {
+			const auto cxxType = dynamic_cast<const CXXType*>(type);
+			if (!cxxType)
+				return none;
+			if (auto it = m_types.find(cxxType); it != m_types.end())
+				return it->second;
+
+			TypeRecord record{};
+			record.type = none;
+			record.symbol = none;
+			record.constQualified = cxxType->constQualified;
+			record.volatileQualified = cxxType->volatileQualified;
+			record.spelling = this->str(cxxType->spelling());
+
+			if (auto basic = dynamic_cast<const BasicCXXType*>(cxxType))
+			{
+				record.tag = TypeTag::Basic;
+				record.basicKind = (uint32_t)basic->kind();
+			}
+			else if (auto tdef = dynamic_cast<const TypedefType*>(cxxType))
+			{
+				record.tag = TypeTag::Typedef;
+				record.symbol = this->symbol(tdef->symbol.get());
+				record.spelling = this->str(tdef->typedefName.str());
+			}
+			else if (auto elaborated = dynamic_cast<const ElaboratedType*>(cxxType))
+			{
+				record.tag = TypeTag::Elaborated;
+				record.type = this->type(elaborated->named.get());
+			}
+			else if (auto rec = dynamic_cast<const RecordType*>(cxxType))
+			{
+				record.tag = TypeTag::Record;
+				record.symbol = this->symbol(rec->recorded.get());
+			}
+			else if (auto e = dynamic_cast<const EnumType*>(cxxType))
+			{
+				record.tag = TypeTag::Enum;
+				record.symbol = this->symbol(e->enumSymbol.get());
+			}
+			else if (auto pointer = dynamic_cast<const PointerLikeType*>(cxxType))
+			{
+				if (dynamic_cast<const PointerType*>(cxxType))
+					record.tag = TypeTag::Pointer;
+				else if (dynamic_cast<const LValueReferenceType*>(cxxType))
+					record.tag = TypeTag::LValueReference;
+				else
+					record.tag = TypeTag::RValueReference;
+				record.type = this->type(pointer->pointee.get());
+			}
+			else
+				record.tag = TypeTag::Unexposed;
+
+			const auto index = (uint32_t)this->types.size();
+			this->types.push_back(record);
+			m_types.emplace(cxxType, index);
+			return index;
+		}
+
+		Range locationsOf(const set<Location>& locations) {
+			const Range range{ (uint32_t)this->locations.size(), (uint32_t)locations.size() };
+			for (const auto& location : locations)
+				this->locations.push_back({ this->str(location.file.str()), (uint32_t)location.line, (uint32_t)location.column, (uint32_t)location.offset });
+			return range;
+		}
+
+	private:
+		const FrozenRegistry& m_registry;
+		std::unordered_map<string, StrRef> m_strings;
+		std::unordered_map<const CXXType*, uint32_t> m_types;
+	};
+
+	template <typename T>
+	std::span<const char> as_bytes(const vector<T>& records)
+	{
+		return { reinterpret_cast<const char*>(records.data()), records.size() * sizeof(T) };
+	}
+}
+
+namespace lcdoc
+{
+	void write_index(const path& file, const FrozenRegistry& registry)
+	{
+		IndexWriter w(registry);
+
+		const auto childOffsets = registry.childOffsets();
+		for (uint32_t i = 0; i < (uint32_t)registry.size(); ++i)
+		{
+			const Symbol& symbol = registry.symbol(i);
+
+			SymbolRecord record{};
+			record.kind = (uint8_t)symbol.kind();
+			record.flags = symbol.exposed ? Exposed : 0;
+			record.parent = registry.parent(i);
+			record.children = { childOffsets[i], childOffsets[i + 1] - childOffsets[i] };
+			record.usr = w.str(symbol.usr());
+			record.qualifiedName = w.str(registry.id(i).to_display_string());
+			record.spelling = w.str(symbol.spelling.str());
+			record.displayName = w.str(symbol.displayName.str());
+			// the index is read without the sources, the comments are resolved now
+			record.docBrief = w.str(symbol.docStr.brief());
+			record.docRaw = w.str(symbol.docStr.raw());
+			record.declarations = w.locationsOf(symbol.declarations);
+			record.definitions = w.locationsOf(symbol.definitions);
+			record.type = none;
+
+			if (auto e = dynamic_cast<const EnumSymbol*>(&symbol); e && e->scoped)
+				record.flags |= ScopedEnum;
+
+			if (auto f = dynamic_cast<const FunctionSymbol*>(&symbol))
+			{
+				record.mangling = w.str(f->mangling);
+				if (f->signature)
+				{
+					record.flags |= HasSignature;
+					record.type = w.type(f->signature->ret.get());
+					vector<ArgRecord> args;
+					for (const auto& arg : f->signature->args)
+						args.push_back({ w.type(arg.type.get()), w.str(arg.name.str()) });
+					record.args = { (uint32_t)w.args.size(), (uint32_t)args.size() };
+					w.args.insert(w.args.end(), args.begin(), args.end());
+				}
+			}
+
+			if (auto tdef = dynamic_cast<const TypedefSymbol*>(&symbol))
+				record.type = w.type(tdef->underlying.get());
+
+			w.symbols.push_back(record);
+		}
+
+		w.children.assign(registry.allChildren().begin(), registry.allChildren().end());
+		w.roots.assign(registry.roots().begin(), registry.roots().end());
+
+		for (size_t kind = 0; kind < symbol_kind_count; ++kind)
+		{
+			w.kindOffsets.push_back((uint32_t)w.byKind.size());
+			const auto symbols = registry.ofKind((SymbolKind)kind);
+			w.byKind.insert(w.byKind.end(), symbols.begin(), symbols.end());
+		}
+		w.kindOffsets.push_back((uint32_t)w.byKind.size());
+
+		// sorted by name for the binary search of ProjectIndex::declaredIn
+		std::map<string, std::pair<uint32_t, uint32_t>> files;
+		for (const auto& [name, range] : registry.fileRanges())
+			files.emplace(name.str(), range);
+		for (const auto& [name, range] : files)
+		{
+			w.files.push_back({ w.str(name), { (uint32_t)w.byFile.size(), range.second - range.first } });
+			const auto symbols = registry.fileSymbols().subspan(range.first, range.second - range.first);
+			w.byFile.insert(w.byFile.end(), symbols.begin(), symbols.end());
+		}
+
+		const vector<int32_t> seeds(registry.hashSeeds().begin(), registry.hashSeeds().end());
+		const vector<uint32_t> slots(registry.hashSlots().begin(), registry.hashSlots().end());
+
+		const std::span<const char> sections[(size_t)SectionId::Count] = {
+			as_bytes(w.strings),
+			as_bytes(w.symbols),
+			as_bytes(w.children),
+			as_bytes(w.roots),
+			as_bytes(w.locations),
+			as_bytes(w.types),
+			as_bytes(w.args),
+			as_bytes(seeds),
+			as_bytes(slots),
+			as_bytes(w.kindOffsets),
+			as_bytes(w.byKind),
+			as_bytes(w.files),
+			as_bytes(w.byFile),
+		};
+
+		Header header{};
+		std::copy(std::begin(lcdx::magic), std::end(lcdx::magic), header.magic);
+		header.version = lcdx::version;
+		header.byteOrder = byte_order_mark;
+		header.sectionCount = (uint32_t)SectionId::Count;
+
+		uint64_t offset = sizeof(Header);
+		for (size_t i = 0; i < (size_t)SectionId::Count; ++i)
+		{
+			offset = (offset + section_alignment - 1) / section_alignment * section_alignment;
+			header.sections[i] = { offset, sections[i].size() };
+			offset += sections[i].size();
+		}
+
+		std::ofstream out(file, std::ios::binary | std::ios::trunc);
+		if (!out)
+			throw std::runtime_error("cannot write " + file.string());
+
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		uint64_t written = sizeof(Header);
+		for (size_t i = 0; i < (size_t)SectionId::Count; ++i)
+		{
+			static const char padding[section_alignment] = {};
+			out.write(padding, header.sections[i].offset - written);
+			out.write(sections[i].data(), sections[i].size());
+			written = header.sections[i].offset + sections[i].size();
+		}
+
+		if (!out)
+			throw std::runtime_error("cannot write " + file.string());
+	}
+
+	template <typename T>
+	std::span<const T> ProjectIndex::section(const lcdx::Header& header, lcdx::SectionId id) const
+	{
+		const auto bytes = m_file.bytes();
+		const lcdx::Section& s = header.sections[(size_t)id];
+		if (s.offset > bytes.size() || s.size > bytes.size() - s.offset || s.size % sizeof(T) != 0 || s.offset % alignof(T) != 0)
+			throw std::runtime_error("corrupted index");
+		return { reinterpret_cast<const T*>(bytes.data() + s.offset), (size_t)(s.size / sizeof(T)) };
+	}
+
+	ProjectIndex::ProjectIndex(const path& file) :
+		m_file(file)
+	{
+		const auto bytes = m_file.bytes();
+		if (bytes.size() < sizeof(lcdx::Header))
+			throw std::runtime_error("not a lcdoc index");
+
+		// the mapping is page aligned, the records are read in place
+		const auto& header = *reinterpret_cast<const lcdx::Header*>(bytes.data());
+		if (!std::equal(std::begin(lcdx::magic), std::end(lcdx::magic), header.magic))
+			throw std::runtime_error("not a lcdoc index");
+		if (header.version != lcdx::version)
+			throw std::runtime_error("unsupported index version");
+		if (header.byteOrder != lcdx::byte_order_mark)
+			throw std::runtime_error("the index was written on a machine with another byte order");
+		if (header.sectionCount != (uint32_t)lcdx::SectionId::Count)
+			throw std::runtime_error("corrupted index");
+
+		using lcdx::SectionId;
+		m_strings = this->section<char>(header, SectionId::Strings);
+		m_symbols = this->section<lcdx::SymbolRecord>(header, SectionId::Symbols);
+		m_children = this->section<uint32_t>(header, SectionId::Children);
+		m_roots = this->section<uint32_t>(header, SectionId::Roots);
+		m_locations = this->section<lcdx::LocationRecord>(header, SectionId::Locations);
+		m_types = this->section<lcdx::TypeRecord>(header, SectionId::Types);
+		m_args = this->section<lcdx::ArgRecord>(header, SectionId::Args);
+		m_seeds = this->section<int32_t>(header, SectionId::HashSeeds);
+		m_slots = this->section<uint32_t>(header, SectionId::HashSlots);
+		m_kindOffsets = this->section<uint32_t>(header, SectionId::KindOffsets);
+		m_byKind = this->section<uint32_t>(header, SectionId::ByKind);
+		m_files = this->section<lcdx::FileRecord>(header, SectionId::Files);
+		m_byFile = this->section<uint32_t>(header, SectionId::ByFile);
+
+		// only the tables used without bound checks are validated, the records are trusted
+		if (m_seeds.size() != m_symbols.size() || m_slots.size() != m_symbols.size())
+			throw std::runtime_error("corrupted index");
+		if (m_kindOffsets.size() != symbol_kind_count + 1 || !std::is_sorted(m_kindOffsets.begin(), m_kindOffsets.end()) || m_kindOffsets.back() > m_byKind.size())
+			throw std::runtime_error("corrupted index");
+	}
+
+	uint32_t ProjectIndex::indexOf(std::string_view usr) const
+	{
+		const uint32_t n = (uint32_t)m_symbols.size();
+		if (n == 0)
+			return no_symbol;
+
+		const uint64_t hash = hash_bytes(usr);
+		const uint32_t slot = perfect_hash_slot(hash, m_seeds[hash_seeded(hash, 0) % n], n);
+		if (slot >= n)
+			return no_symbol;
+
+		const uint32_t index = m_slots[slot];
+		if (index >= n || this->symbol(index).usr() != usr)
+			return no_symbol;
+		return index;
+	}
+
+	std::span<const uint32_t> ProjectIndex::declaredIn(std::string_view file) const
+	{
+		auto it = std::lower_bound(m_files.begin(), m_files.end(), file, [this](const lcdx::FileRecord& record, std::string_view file) {
+			return this->string(record.file) < file;
+		});
+		if (it == m_files.end() || this->string(it->file) != file)
+			return {};
+		return slice(m_byFile, it->symbols);
+	}
+}
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <memory>
+
+#include "FrozenRegistry.hpp"
+#include "MappedFile.hpp"
+
+namespace lcdoc
+{
+	// The .lcdx index: a frozen registry laid out so that it can be memory mapped and read in place.
+	// The file starts with a Header followed by the sections, every section is an array of
+	// fixed size records in native byte order (the header records the byte order of the writer).
+	// Strings are stored once in the Strings section and referenced by StrRef.
+	namespace lcdx
+	{
+		inline constexpr char magic[4] = { 'L', 'C', 'D', 'X' };
+		inline constexpr uint32_t version = 1;
+		inline constexpr uint32_t byte_order_mark = 0x01020304;
+
+		// no type, no symbol
+		inline constexpr uint32_t none = ~uint32_t(0);
+
+		enum class SectionId : uint32_t
+		{
+			Strings,
+			Symbols,
+			Children,
+			Roots,
+			Locations,
+			Types,
+			Args,
+			HashSeeds,
+			HashSlots,
+			KindOffsets,
+			ByKind,
+			Files,
+			ByFile,
+			Count,
+		};
+
+		struct Section
+		{
+			uint64_t offset = 0;
+			uint64_t size = 0; // bytes
+		};
+
+		struct Header
+		{
+			char magic[4];
+			uint32_t version;
+			uint32_t byteOrder;
+			uint32_t sectionCount;
+			Section sections[(size_t)SectionId::Count];
+		};
+
+		struct StrRef
+		{
+			uint32_t offset = 0;
+			uint32_t size = 0;
+		};
+
+		struct Range
+		{
+			uint32_t first = 0;
+			uint32_t count = 0;
+		};
+
+		enum SymbolFlags : uint8_t
+		{
+			Exposed = 1,
+			ScopedEnum = 2,
+			HasSignature = 4,
+		};
+
+		struct SymbolRecord
+		{
+			uint8_t kind; // SymbolKind
+			uint8_t flags; // SymbolFlags
+			uint16_t reserved;
+			uint32_t parent;
+			Range children; // in Children
+			StrRef usr;
+			StrRef qualifiedName;
+			StrRef spelling;
+			StrRef displayName;
+			StrRef docBrief;
+			StrRef docRaw;
+			StrRef mangling;
+			Range declarations; // in Locations
+			Range definitions; // in Locations
+			uint32_t type; // return type of functions, underlying type of typedefs
+			Range args; // in Args
+		};
+
+		struct LocationRecord
+		{
+			StrRef file;
+			uint32_t line;
+			uint32_t column;
+			uint32_t offset;
+		};
+
+		enum class TypeTag : uint8_t
+		{
+			Unexposed,
+			Basic,
+			Typedef,
+			Elaborated,
+			Record,
+			Enum,
+			Pointer,
+			LValueReference,
+			RValueReference,
+		};
+
+		struct TypeRecord
+		{
+			TypeTag tag;
+			uint8_t constQualified;
+			uint8_t volatileQualified;
+			uint8_t reserved;
+			uint32_t basicKind; // CXTypeKind of basic types
+			uint32_t type; // named type of elaborated types, pointee of pointers and references
+			uint32_t symbol; // recorded symbol of records, enums and typedefs
+			StrRef spelling;
+		};
+
+		struct ArgRecord
+		{
+			uint32_t type;
+			StrRef name;
+		};
+
+		struct FileRecord
+		{
+			StrRef file;
+			Range symbols; // in ByFile
+		};
+	}
+
+	// writes the frozen registry as a .lcdx index, throws std::runtime_error on failure
+	void write_index(const path& file, const FrozenRegistry& registry);
+
+	// A .lcdx index mapped in memory: the records are read in place, nothing is deserialized.
+	class ProjectIndex
+	{
+	public:
+
+		// throws std::runtime_error if the file is not a valid index
+		explicit ProjectIndex(const path& file);
+
+		class SymbolView
+		{
+		public:
+
+			SymbolView(const ProjectIndex& index, uint32_t position) : m_index(&index), m_position(position) {}
+
+			uint32_t position() const { return m_position; }
+			const lcdx::SymbolRecord& record() const { return m_index->m_symbols[m_position]; }
+
+			SymbolKind kind() const { return (SymbolKind)this->record().kind; }
+			bool exposed() const { return this->record().flags & lcdx::Exposed; }
+
+			std::string_view usr() const { return m_index->string(this->record().usr); }
+			std::string_view qualifiedName() const { return m_index->string(this->record().qualifiedName); }
+			std::string_view spelling() const { return m_index->string(this->record().spelling); }
+			std::string_view displayName() const { return m_index->string(this->record().displayName); }
+			std::string_view docBrief() const { return m_index->string(this->record().docBrief); }
+			std::string_view docRaw() const { return m_index->string(this->record().docRaw); }
+
+			// no_symbol for top level symbols
+			uint32_t parent() const { return this->record().parent; }
+			std::span<const uint32_t> children() const { return m_index->slice(m_index->m_children, this->record().children); }
+
+			std::span<const lcdx::LocationRecord> declarations() const { return m_index->slice(m_index->m_locations, this->record().declarations); }
+			std::span<const lcdx::LocationRecord> definitions() const { return m_index->slice(m_index->m_locations, this->record().definitions); }
+
+		private:
+			const ProjectIndex* m_index;
+			uint32_t m_position;
+		};
+
+		size_t size() const { return m_symbols.size(); }
+
+		SymbolView symbol(uint32_t position) const { return SymbolView(*this, position); }
+
+		// no_symbol if not found
+		uint32_t indexOf(std::string_view usr) const;
+
+		std::span<const uint32_t> roots() const { return m_roots; }
+
+		// sorted by qualified name
+		std::span<const uint32_t> ofKind(SymbolKind kind) const {
+			return { m_byKind.data() + m_kindOffsets[(size_t)kind], m_byKind.data() + m_kindOffsets[(size_t)kind + 1] };
+		}
+
+		// the symbols declared or defined in `file`, sorted by qualified name
+		std::span<const uint32_t> declaredIn(std::string_view file) const;
+
+		const lcdx::TypeRecord& type(uint32_t index) const { return m_types[index]; }
+		std::span<const lcdx::ArgRecord> args(const SymbolView& function) const { return this->slice(m_args, function.record().args); }
+
+		std::string_view string(lcdx::StrRef ref) const {
+			return { m_strings.data() + ref.offset, ref.size };
+		}
+
+	private:
+
+		template <typename T>
+		static std::span<const T> slice(std::span<const T> records, lcdx::Range range) {
+			return records.subspan(range.first, range.count);
+		}
+
+		template <typename T>
+		std::span<const T> section(const lcdx::Header& header, lcdx::SectionId id) const;
+
+		MappedFile m_file;
+
+		std::span<const char> m_strings;
+		std::span<const lcdx::SymbolRecord> m_symbols;
+		std::span<const uint32_t> m_children;
+		std::span<const uint32_t> m_roots;
+		std::span<const lcdx::LocationRecord> m_locations;
+		std::span<const lcdx::TypeRecord> m_types;
+		std::span<const lcdx::ArgRecord> m_args;
+		std::span<const int32_t> m_seeds;
+		std::span<const uint32_t> m_slots;
+		std::span<const uint32_t> m_kindOffsets;
+		std::span<const uint32_t> m_byKind;
+		std::span<const lcdx::FileRecord> m_files; // sorted by file name
+		std::span<const uint32_t> m_byFile;
+	};
+}
@@ -0,0 +1,128 @@
+#include <fstream>
+#include <format>
+#include <charconv>
+#include <stdexcept>
+
+#include "binary_io.hpp"
+#include "registry_io.hpp"
+
+#include "Shard.hpp"
+
+namespace lcdoc
+{
+	namespace
+	{
+		constexpr uint32_t partial_magic = 0x5344434c; // "LCDS"
+
+		struct PartialHeader
+		{
+			Shard shard;
+			uint64_t inputFiles = 0;
+		};
+
+		PartialHeader read_header(std::istream& in, const path& file)
+		{
+			BinaryReader r(in);
+			if (r.u32() != partial_magic)
+				throw std::runtime_error(file.string() + " is not a partial registry");
+			if (r.u32() != registry_format_version)
+				throw std::runtime_error(file.string() + " was written by another version of lcdoc");
+
+			PartialHeader header;
+			header.shard.index = r.u32();
+			header.shard.count = r.u32();
+			header.inputFiles = r.u64();
+			if (header.shard.index < 1 || header.shard.index > header.shard.count)
+				throw std::runtime_error(file.string() + " is corrupted");
+			return header;
+		}
+	}
+
+	Shard Shard::parse(std::string_view spec)
+	{
+		const auto slash = spec.find('/');
+		if (slash == std::string_view::npos)
+			throw std::runtime_error("invalid shard \"" + string(spec) + "\", expected i/N");
+
+		const auto number = [&](std::string_view text) {
+			unsigned value = 0;
+			const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+			if (ec != std::errc() || end != text.data() + text.size())
+				throw std::runtime_error("invalid shard \"" + string(spec) + "\", expected i/N");
+			return value;
+		};
+
+		Shard shard{ number(spec.substr(0, slash)), number(spec.substr(slash + 1)) };
+		if (shard.index < 1 || shard.index > shard.count)
+			throw std::runtime_error(std::format("invalid shard {}/{}, the index must be in [1, {}]", shard.index, shard.count, shard.count));
+		return shard;
+	}
+
+	void write_partial(const path& file, const Shard& shard, size_t inputFiles, const SymbolRegistry& registry)
+	{
+		// written to a temporary file and renamed, so that an interrupted run never leaves half a partial
+		path tmp = file;
+		tmp += ".tmp";
+		{
+			std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+			if (!out)
+				throw std::runtime_error("cannot write " + tmp.string());
+
+			BinaryWriter w(out);
+			w.u32(partial_magic);
+			w.u32(registry_format_version);
+			w.u32(shard.index);
+			w.u32(shard.count);
+			w.u64(inputFiles);
+			write_registry(out, registry);
+
+			if (!out)
+				throw std::runtime_error("cannot write " + tmp.string());
+		}
+		std::filesystem::rename(tmp, file);
+	}
+
+	SymbolRegistry merge_partials(const vector<path>& files)
+	{
+		if (files.empty())
+			throw std::runtime_error("no partial registry to merge");
+
+		// only the headers are read here, the registries are then loaded one at a time
+		vector<path> byShard;
+		PartialHeader first;
+		for (const auto& file : files)
+		{
+			std::ifstream in(file, std::ios::binary);
+			if (!in)
+				throw std::runtime_error("cannot read " + file.string());
+			const auto header = read_header(in, file);
+
+			if (byShard.empty())
+			{
+				first = header;
+				byShard.resize(header.shard.count);
+			}
+			else if (header.shard.count != first.shard.count || header.inputFiles != first.inputFiles)
+				throw std::runtime_error(file.string() + " comes from another split of the project");
+
+			auto& slot = byShard[header.shard.index - 1];
+			if (!slot.empty())
+				throw std::runtime_error(std::format("shard {}/{} is given twice: {} and {}", header.shard.index, header.shard.count, slot.string(), file.string()));
+			slot = file;
+		}
+
+		for (size_t i = 0; i < byShard.size(); ++i)
+			if (byShard[i].empty())
+				throw std::runtime_error(std::format("shard {}/{} is missing", i + 1, byShard.size()));
+
+		// every symbol is looked up once in the USR index of the result: linear in the total number of symbols
+		SymbolRegistry merged;
+		for (const auto& file : byShard)
+		{
+			std::ifstream in(file, std::ios::binary);
+			read_header(in, file);
+			merged.merge(read_registry(in));
+		}
+		return merged;
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "Symbol.hpp"
+
+namespace lcdoc
+{
+	using std::string;
+	using std::vector;
+	using std::filesystem::path;
+
+	// A contiguous range of the input files of a project, parsed on its own (e.g. on another CI runner).
+	// The partial registries are merged in shard order, which is the input order: the result is the
+	// same registry a single parse of all the files would produce.
+	struct Shard
+	{
+		unsigned index = 1; // 1-based
+		unsigned count = 1;
+
+		// parses "i/N", throws std::runtime_error if malformed
+		static Shard parse(std::string_view spec);
+
+		// the [first, last) range of the `files` input files that belong to this shard
+		std::pair<size_t, size_t> range(size_t files) const {
+			return { files * (this->index - 1) / this->count, files * this->index / this->count };
+		}
+	};
+
+	// writes the registry parsed for `shard` of a project with `inputFiles` input files
+	void write_partial(const path& file, const Shard& shard, size_t inputFiles, const SymbolRegistry& registry);
+
+	// merges the partial registries of all the shards of a project, in any order.
+	// Throws std::runtime_error if a shard is missing, repeated or comes from a different split
+	SymbolRegistry merge_partials(const vector<path>& files);
+}
@@ -0,0 +1,60 @@
+#include <stdexcept>
+
+#include "StringPool.hpp"
+
+namespace lcdoc
+{
+	StringPool& StringPool::global()
+	{
+		static StringPool pool;
+		return pool;
+	}
+
+	StringPool::StringPool() :
+		m_chunks(new std::atomic<string*>[max_chunks])
+	{
+		for (uint32_t i = 0; i < max_chunks; ++i)
+			m_chunks[i].store(nullptr, std::memory_order_relaxed);
+		this->intern("");
+	}
+
+	StringPool::~StringPool()
+	{
+		for (uint32_t i = 0; i < max_chunks; ++i)
+			delete[] m_chunks[i].load(std::memory_order_relaxed);
+	}
+
+	uint32_t StringPool::intern(std::string_view value)
+	{
+		std::lock_guard lock(m_mutex);
+
+		if (auto it = m_handles.find(value); it != m_handles.end())
+			return it->second;
+
+		const uint32_t handle = m_size;
+		const uint32_t chunkIndex = handle >> chunk_bits;
+		if (chunkIndex >= max_chunks)
+			throw std::runtime_error("string pool exhausted");
+
+		string* chunk = m_chunks[chunkIndex].load(std::memory_order_relaxed);
+		if (!chunk)
+		{
+			chunk = new string[chunk_size];
+			m_chunks[chunkIndex].store(chunk, std::memory_order_release);
+		}
+
+		string& stored = chunk[handle & (chunk_size - 1)];
+		stored = value;
+		++m_size;
+
+		// the key views the pooled copy, which never moves
+		m_handles.emplace(std::string_view(stored), handle);
+		return handle;
+	}
+
+	size_t StringPool::size() const
+	{
+		std::lock_guard lock(m_mutex);
+		return m_size;
+	}
+}
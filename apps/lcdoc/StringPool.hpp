@@ -0,0 +1,89 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <compare>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+
+namespace lcdoc
+{
+	using std::string;
+
+	// Process wide pool of interned strings: equal strings share a single copy and are identified by a 32 bit handle.
+	// Handles stay valid across registries, so they survive merges. Strings are never released.
+	// Interning is thread safe, reading an interned string does not lock.
+	class StringPool
+	{
+	public:
+
+		static StringPool& global();
+
+		StringPool();
+		StringPool(const StringPool&) = delete;
+		StringPool& operator=(const StringPool&) = delete;
+		~StringPool();
+
+		// handle 0 is the empty string
+		uint32_t intern(std::string_view value);
+
+		const string& at(uint32_t handle) const {
+			const string* chunk = m_chunks[handle >> chunk_bits].load(std::memory_order_acquire);
+			return chunk[handle & (chunk_size - 1)];
+		}
+
+		size_t size() const;
+
+	private:
+
+		static constexpr uint32_t chunk_bits = 16;
+		static constexpr uint32_t chunk_size = 1u << chunk_bits;
+		static constexpr uint32_t max_chunks = 1u << (32 - chunk_bits);
+
+		// the strings are stored in chunks that are never moved, so that they can be read while other strings are added
+		std::unique_ptr<std::atomic<string*>[]> m_chunks;
+		uint32_t m_size = 0;
+
+		std::unordered_map<std::string_view, uint32_t> m_handles;
+		mutable std::mutex m_mutex;
+	};
+
+	// A string interned in the global StringPool: 4 bytes, compared by handle for equality
+	// and by content for ordering, so that sorted output does not depend on the interning order.
+	class InternedString
+	{
+	public:
+
+		InternedString() = default;
+		InternedString(std::string_view value) : m_handle(StringPool::global().intern(value)) {}
+		InternedString(const string& value) : InternedString(std::string_view(value)) {}
+		InternedString(const char* value) : InternedString(std::string_view(value)) {}
+
+		const string& str() const { return StringPool::global().at(m_handle); }
+		operator const string&() const { return this->str(); }
+
+		bool empty() const { return m_handle == 0; }
+		uint32_t handle() const { return m_handle; }
+
+		bool operator==(const InternedString&) const = default;
+		std::strong_ordering operator<=>(const InternedString& other) const {
+			if (m_handle == other.m_handle)
+				return std::strong_ordering::equal;
+			return this->str() <=> other.str();
+		}
+
+	private:
+		uint32_t m_handle = 0;
+	};
+}
+
+template <>
+struct std::hash<lcdoc::InternedString>
+{
+	size_t operator()(const lcdoc::InternedString& value) const noexcept {
+		return std::hash<uint32_t>()(value.handle());
+	}
+};
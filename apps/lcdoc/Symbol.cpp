@@ -1,7 +1,823 @@
+#include <typeinfo>
+#include <algorithm>
+#include <stdexcept>
+#include <tuple>
+#include <bit>
 
 #include "Symbol.hpp"
+#include "hash.hpp"
 
 namespace lcdoc
 {
+	namespace
+	{
+		using Canonical = std::function<shared_ptr<Symbol>(const shared_ptr<Symbol>&)>;
 
-}
\ No newline at end of file
+		// maps a symbol of another registry to the symbol with the same USR in `registry`, if any
+		Canonical canonical_in(const SymbolRegistry& registry)
+		{
+			return [&registry](const shared_ptr<Symbol>& symbol) -> shared_ptr<Symbol> {
+				if (!symbol)
+					return nullptr;
+				if (auto found = registry.find(symbol->usr()))
+					return found;
+				return symbol;
+			};
+		}
+
+		// Moves the types of `source` into the interner of `target`: a type already interned in `target`
+		// is reused, otherwise it is rebuilt with the symbols of `target` and interned.
+		// Types can be shared between registries, so they are never modified: the nodes that
+		// change are copied and the unchanged subtrees are reused.
+		class TypeImporter
+		{
+		public:
+
+			TypeImporter(SymbolRegistry& target, const SymbolRegistry& source) :
+				TypeImporter(target.types, canonical_in(target), source)
+			{
+			}
+
+			TypeImporter(TypeInterner& types, Canonical canonical, const SymbolRegistry& source) :
+				m_types(types),
+				m_source(source),
+				m_canonical(std::move(canonical))
+			{
+				for (const auto& [key, type] : source.types.entries())
+					m_keys.emplace(type.get(), &key);
+			}
+
+			shared_ptr<CXXType> operator()(const shared_ptr<CXXType>& type) {
+				if (!type)
+					return nullptr;
+
+				if (auto it = m_imported.find(type.get()); it != m_imported.end())
+					return it->second;
+
+				shared_ptr<CXXType> result;
+				const auto key = m_keys.find(type.get());
+				if (key != m_keys.end())
+					result = m_types.find(*key->second);
+
+				if (!result)
+				{
+					result = this->rebuilt(type);
+					if (key != m_keys.end())
+						m_types.add(*key->second, result);
+				}
+
+				m_imported[type.get()] = result;
+				return result;
+			}
+
+			shared_ptr<Type> operator()(const shared_ptr<Type>& type) {
+				if (auto cxxType = std::dynamic_pointer_cast<CXXType>(type))
+					return (*this)(cxxType);
+				return type;
+			}
+
+			const SymbolRegistry& source() const { return m_source; }
+
+		private:
+
+			shared_ptr<CXXType> rebuilt(const shared_ptr<CXXType>& type) {
+				const auto qualified = [&](const shared_ptr<CXXType>& result) {
+					result->constQualified = type->constQualified;
+					result->volatileQualified = type->volatileQualified;
+					return result;
+				};
+
+				if (auto elaborated = std::dynamic_pointer_cast<ElaboratedType>(type))
+				{
+					auto named = (*this)(elaborated->named);
+					if (named == elaborated->named)
+						return type;
+					auto result = std::make_shared<ElaboratedType>();
+					result->named = named;
+					return qualified(result);
+				}
+
+				if (auto pointer = std::dynamic_pointer_cast<PointerLikeType>(type))
+				{
+					auto pointee = (*this)(pointer->pointee);
+					if (pointee == pointer->pointee)
+						return type;
+					shared_ptr<PointerLikeType> result;
+					if (std::dynamic_pointer_cast<PointerType>(type))
+						result = std::make_shared<PointerType>();
+					else if (std::dynamic_pointer_cast<LValueReferenceType>(type))
+						result = std::make_shared<LValueReferenceType>();
+					else
+						result = std::make_shared<RValueReferenceType>();
+					result->pointee = pointee;
+					return qualified(result);
+				}
+
+				if (auto record = std::dynamic_pointer_cast<RecordType>(type))
+				{
+					auto recorded = m_canonical(record->recorded);
+					if (recorded == record->recorded)
+						return type;
+					auto result = std::make_shared<RecordType>();
+					result->recorded = recorded;
+					return qualified(result);
+				}
+
+				if (auto e = std::dynamic_pointer_cast<EnumType>(type))
+				{
+					auto enumSymbol = std::dynamic_pointer_cast<EnumSymbol>(m_canonical(e->enumSymbol));
+					if (enumSymbol == e->enumSymbol)
+						return type;
+					auto result = std::make_shared<EnumType>();
+					result->enumSymbol = enumSymbol;
+					return qualified(result);
+				}
+
+				if (auto tdef = std::dynamic_pointer_cast<TypedefType>(type))
+				{
+					auto symbol = std::dynamic_pointer_cast<TypedefSymbol>(m_canonical(tdef->symbol));
+					if (symbol == tdef->symbol)
+						return type;
+					auto result = std::make_shared<TypedefType>();
+					result->symbol = symbol;
+					result->typedefName = tdef->typedefName;
+					return qualified(result);
+				}
+
+				return type;
+			}
+
+		private:
+			TypeInterner& m_types;
+			const SymbolRegistry& m_source;
+			Canonical m_canonical;
+			std::unordered_map<const CXXType*, const TypeInterner::Key*> m_keys;
+			std::unordered_map<const CXXType*, shared_ptr<CXXType>> m_imported;
+		};
+
+		// relinks the types of the signature of a function or of the underlying type of a typedef
+		void relink_types(Symbol& symbol, TypeImporter& import)
+		{
+			if (auto f = dynamic_cast<FunctionSymbol*>(&symbol); f && f->signature)
+			{
+				f->signature->ret = import(f->signature->ret);
+				for (auto& arg : f->signature->args)
+					arg.type = import(arg.type);
+			}
+
+			if (auto tdef = dynamic_cast<TypedefSymbol*>(&symbol))
+				tdef->underlying = import(tdef->underlying);
+		}
+
+		// Relinks the parent and the types of a symbol that has been moved to the registry `target`.
+		// The parent index of `symbol` still refers to the source registry.
+		void relink(Symbol& symbol, TypeImporter& import, const SymbolRegistry& target)
+		{
+			if (symbol.parentIndex != no_symbol && symbol.parentIndex < import.source().symbols.size())
+			{
+				const auto parent = target.find(import.source().symbols.at(symbol.parentIndex)->usr());
+				symbol.parentIndex = parent ? parent->index() : no_symbol;
+			}
+
+			relink_types(symbol, import);
+		}
+
+		// an empty symbol of the same kind as `symbol`, allocated in `arena`
+		shared_ptr<Symbol> make_like(const Symbol& symbol, const shared_ptr<SymbolArena>& arena)
+		{
+			const auto& part = symbol.idPart();
+			const auto usr = symbol.internedUsr();
+			if (dynamic_cast<const UnexposedDeclarationSymbol*>(&symbol)) return make_symbol_in<UnexposedDeclarationSymbol>(arena, part, usr);
+			if (dynamic_cast<const TypedefSymbol*>(&symbol)) return make_symbol_in<TypedefSymbol>(arena, part, usr);
+			if (dynamic_cast<const NamespaceSymbol*>(&symbol)) return make_symbol_in<NamespaceSymbol>(arena, part, usr);
+			if (dynamic_cast<const EnumSymbol*>(&symbol)) return make_symbol_in<EnumSymbol>(arena, part, usr);
+			if (dynamic_cast<const FunctionSymbol*>(&symbol)) return make_symbol_in<FunctionSymbol>(arena, part, usr);
+			if (dynamic_cast<const StructSymbol*>(&symbol)) return make_symbol_in<StructSymbol>(arena, part, usr);
+			if (dynamic_cast<const ClassSymbol*>(&symbol)) return make_symbol_in<ClassSymbol>(arena, part, usr);
+			if (dynamic_cast<const StructLikeSymbol*>(&symbol)) return make_symbol_in<StructLikeSymbol>(arena, part, usr);
+			throw std::runtime_error("cannot copy symbol of kind " + symbol.kindSpelling());
+		}
+
+		// copies the types of the signature of a function or the underlying type of a typedef, the types are shared
+		void assign_types(Symbol& to, const Symbol& from)
+		{
+			if (auto f = dynamic_cast<FunctionSymbol*>(&to))
+			{
+				const auto& other = dynamic_cast<const FunctionSymbol&>(from);
+				f->signature = other.signature ? std::make_unique<FunctionSignature>(*other.signature) : nullptr;
+			}
+
+			if (auto tdef = dynamic_cast<TypedefSymbol*>(&to))
+				tdef->underlying = dynamic_cast<const TypedefSymbol&>(from).underlying;
+		}
+
+		// copies everything but the identity, the types are shared
+		void assign(Symbol& to, const Symbol& from)
+		{
+			to.docStr = from.docStr;
+			to.spelling = from.spelling;
+			to.displayName = from.displayName;
+			to.declarations = from.declarations;
+			to.definitions = from.definitions;
+			to.exposed = from.exposed;
+			to.parentIndex = from.parentIndex;
+
+			if (auto e = dynamic_cast<EnumSymbol*>(&to))
+				e->scoped = dynamic_cast<const EnumSymbol&>(from).scoped;
+
+			if (auto f = dynamic_cast<FunctionSymbol*>(&to))
+				f->mangling = dynamic_cast<const FunctionSymbol&>(from).mangling;
+
+			assign_types(to, from);
+		}
+
+		// the files where a symbol is declared or defined
+		set<InternedString> files_of(const Symbol& symbol)
+		{
+			set<InternedString> files;
+			for (const auto& location : symbol.declarations)
+				files.insert(location.file);
+			for (const auto& location : symbol.definitions)
+				files.insert(location.file);
+			files.erase(InternedString());
+			return files;
+		}
+	}
+
+	shared_ptr<BasicCXXType> make_basic_type(::CXTypeKind kind)
+	{
+		switch (kind)
+		{
+#define lc_tmp_basic_case(cx_type) case cx_type: return std::make_shared<basic_types::get_basic_type<cx_type>::type>();
+
+		// BEGIN Basic Types
+#if true
+		lc_tmp_basic_case(::CXTypeKind::CXType_Void);
+		lc_tmp_basic_case(::CXTypeKind::CXType_Bool);
+		lc_tmp_basic_case(::CXTypeKind::CXType_Char_U);
+		lc_tmp_basic_case(::CXTypeKind::CXType_UChar);
+		lc_tmp_basic_case(::CXTypeKind::CXType_Char16);
+		lc_tmp_basic_case(::CXTypeKind::CXType_Char32);
+		lc_tmp_basic_case(::CXTypeKind::CXType_UShort);
+		lc_tmp_basic_case(::CXTypeKind::CXType_UInt);
+		lc_tmp_basic_case(::CXTypeKind::CXType_ULong);
+		lc_tmp_basic_case(::CXTypeKind::CXType_ULongLong);
+		lc_tmp_basic_case(::CXTypeKind::CXType_UInt128);
+		lc_tmp_basic_case(::CXTypeKind::CXType_Char_S);
+		lc_tmp_basic_case(::CXTypeKind::CXType_SChar);
+		lc_tmp_basic_case(::CXTypeKind::CXType_WChar);
+		lc_tmp_basic_case(::CXTypeKind::CXType_Short);
+		lc_tmp_basic_case(::CXTypeKind::CXType_Int);
+		lc_tmp_basic_case(::CXTypeKind::CXType_Long);
+		lc_tmp_basic_case(::CXTypeKind::CXType_LongLong);
+		lc_tmp_basic_case(::CXTypeKind::CXType_Int128);
+		lc_tmp_basic_case(::CXTypeKind::CXType_Float);
+		lc_tmp_basic_case(::CXTypeKind::CXType_Double);
+		lc_tmp_basic_case(::CXTypeKind::CXType_LongDouble);
+		lc_tmp_basic_case(::CXTypeKind::CXType_NullPtr);
+		lc_tmp_basic_case(::CXTypeKind::CXType_Overload);
+		lc_tmp_basic_case(::CXTypeKind::CXType_Dependent);
+		lc_tmp_basic_case(::CXTypeKind::CXType_ObjCId);
+		lc_tmp_basic_case(::CXTypeKind::CXType_ObjCClass);
+		lc_tmp_basic_case(::CXTypeKind::CXType_ObjCSel);
+		lc_tmp_basic_case(::CXTypeKind::CXType_Float128);
+		lc_tmp_basic_case(::CXTypeKind::CXType_Half);
+		lc_tmp_basic_case(::CXTypeKind::CXType_Float16);
+		lc_tmp_basic_case(::CXTypeKind::CXType_ShortAccum);
+		lc_tmp_basic_case(::CXTypeKind::CXType_Accum);
+		lc_tmp_basic_case(::CXTypeKind::CXType_LongAccum);
+		lc_tmp_basic_case(::CXTypeKind::CXType_UShortAccum);
+		lc_tmp_basic_case(::CXTypeKind::CXType_UAccum);
+		lc_tmp_basic_case(::CXTypeKind::CXType_ULongAccum);
+		lc_tmp_basic_case(::CXTypeKind::CXType_BFloat16);
+		lc_tmp_basic_case(::CXTypeKind::CXType_Ibm128);
+		//lc_tmp_basic_case(::CXTypeKind::CXType_FirstBuiltin);
+		//lc_tmp_basic_case(::CXTypeKind::CXType_LastBuiltin);
+		lc_tmp_basic_case(::CXTypeKind::CXType_Complex);
+		//lc_tmp_basic_case(::CXTypeKind::CXType_Pointer);
+		lc_tmp_basic_case(::CXTypeKind::CXType_BlockPointer);
+		//lc_tmp_basic_case(::CXTypeKind::CXType_LValueReference);
+		//lc_tmp_basic_case(::CXTypeKind::CXType_RValueReference);
+		// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!11 lc_tmp_basic_case(::CXTypeKind::CXType_Record);
+		//lc_tmp_basic_case(::CXTypeKind::CXType_Enum);
+		//lc_tmp_basic_case(::CXTypeKind::CXType_Typedef);
+		lc_tmp_basic_case(::CXTypeKind::CXType_ObjCInterface);
+		lc_tmp_basic_case(::CXTypeKind::CXType_ObjCObjectPointer);
+		lc_tmp_basic_case(::CXTypeKind::CXType_FunctionNoProto);
+		lc_tmp_basic_case(::CXTypeKind::CXType_FunctionProto);
+		lc_tmp_basic_case(::CXTypeKind::CXType_ConstantArray);
+		lc_tmp_basic_case(::CXTypeKind::CXType_Vector);
+		lc_tmp_basic_case(::CXTypeKind::CXType_IncompleteArray);
+		lc_tmp_basic_case(::CXTypeKind::CXType_VariableArray);
+		lc_tmp_basic_case(::CXTypeKind::CXType_DependentSizedArray);
+		lc_tmp_basic_case(::CXTypeKind::CXType_MemberPointer);
+		lc_tmp_basic_case(::CXTypeKind::CXType_Auto);
+		//lc_tmp_basic_case(::CXTypeKind::CXType_Elaborated);
+		lc_tmp_basic_case(::CXTypeKind::CXType_Pipe);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage1dRO);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage1dArrayRO);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage1dBufferRO);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dRO);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dArrayRO);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dDepthRO);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dArrayDepthRO);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dMSAARO);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dArrayMSAARO);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dMSAADepthRO);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dArrayMSAADepthRO);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage3dRO);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage1dWO);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage1dArrayWO);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage1dBufferWO);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dWO);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dArrayWO);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dDepthWO);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dArrayDepthWO);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dMSAAWO);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dArrayMSAAWO);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dMSAADepthWO);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dArrayMSAADepthWO);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage3dWO);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage1dRW);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage1dArrayRW);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage1dBufferRW);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dRW);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dArrayRW);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dDepthRW);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dArrayDepthRW);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dMSAARW);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dArrayMSAARW);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dMSAADepthRW);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dArrayMSAADepthRW);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage3dRW);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLSampler);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLEvent);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLQueue);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLReserveID);
+		lc_tmp_basic_case(::CXTypeKind::CXType_ObjCObject);
+		lc_tmp_basic_case(::CXTypeKind::CXType_ObjCTypeParam);
+		lc_tmp_basic_case(::CXTypeKind::CXType_Attributed);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLIntelSubgroupAVCMcePayload);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLIntelSubgroupAVCImePayload);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLIntelSubgroupAVCRefPayload);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLIntelSubgroupAVCSicPayload);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLIntelSubgroupAVCMceResult);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLIntelSubgroupAVCImeResult);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLIntelSubgroupAVCRefResult);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLIntelSubgroupAVCSicResult);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLIntelSubgroupAVCImeResultSingleRefStreamout);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLIntelSubgroupAVCImeResultDualRefStreamout);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLIntelSubgroupAVCImeSingleRefStreamin);
+		lc_tmp_basic_case(::CXTypeKind::CXType_OCLIntelSubgroupAVCImeDualRefStreamin);
+		lc_tmp_basic_case(::CXTypeKind::CXType_ExtVector);
+		lc_tmp_basic_case(::CXTypeKind::CXType_Atomic);
+#endif
+		// END basic Types
+
+#undef lc_tmp_basic_case
+
+		default:
+			return nullptr;
+		}
+	}
+
+	uint64_t SymbolIndex::hash_usr(std::string_view usr)
+	{
+		return hash_bytes(usr);
+	}
+
+	size_t SymbolIndex::slotOf(std::string_view usr, uint64_t hash) const
+	{
+		const size_t mask = m_slots.size() - 1;
+		for (size_t i = (size_t)hash & mask;; i = (i + 1) & mask)
+		{
+			const Slot& slot = m_slots[i];
+			if (slot.index == empty_index)
+				return i;
+			if (slot.hash == hash && m_symbols[slot.index]->usr() == usr)
+				return i;
+		}
+	}
+
+	void SymbolIndex::rehash(size_t capacity)
+	{
+		m_slots.assign(capacity, Slot());
+		for (uint32_t index = 0; index < (uint32_t)m_symbols.size(); ++index)
+		{
+			const uint64_t hash = hash_usr(m_symbols[index]->usr());
+			m_slots[this->slotOf(m_symbols[index]->usr(), hash)] = { hash, index };
+		}
+	}
+
+	void SymbolIndex::insert(const shared_ptr<Symbol>& symbol)
+	{
+		if (!symbol)
+			return;
+
+		if (2 * (m_symbols.size() + 1) > m_slots.size())
+			this->rehash(std::max<size_t>(16, 2 * m_slots.size()));
+
+		const uint64_t hash = hash_usr(symbol->usr());
+		Slot& slot = m_slots[this->slotOf(symbol->usr(), hash)];
+		if (slot.index != empty_index)
+		{
+			symbol->m_index = slot.index;
+			m_symbols[slot.index] = symbol;
+			return;
+		}
+
+		if (m_symbols.size() >= empty_index)
+			throw std::runtime_error("too many symbols");
+		slot = { hash, (uint32_t)m_symbols.size() };
+		symbol->m_index = slot.index;
+		m_symbols.push_back(symbol);
+	}
+
+	void SymbolIndex::erase(const set<string>& usrs)
+	{
+		if (usrs.empty())
+			return;
+
+		std::erase_if(m_symbols, [&](const shared_ptr<Symbol>& symbol) { return usrs.contains(symbol->usr()); });
+
+		// old index -> new index
+		vector<uint32_t> moved(m_slots.size(), no_symbol);
+		for (uint32_t index = 0; index < (uint32_t)m_symbols.size(); ++index)
+		{
+			moved[m_symbols[index]->m_index] = index;
+			m_symbols[index]->m_index = index;
+		}
+		for (const auto& symbol : m_symbols)
+			if (symbol->parentIndex != no_symbol)
+				symbol->parentIndex = symbol->parentIndex < moved.size() ? moved[symbol->parentIndex] : no_symbol;
+
+		this->rehash(m_slots.size());
+	}
+
+	shared_ptr<CXXType> TypeInterner::basic(::CXTypeKind kind, bool constQualified, bool volatileQualified)
+	{
+		constexpr size_t maxKind = 256;
+
+		// built once, then only read
+		static const auto flyweights = []() {
+			vector<shared_ptr<CXXType>> flyweights(maxKind * 4);
+			for (size_t k = 0; k < maxKind; ++k)
+				for (size_t cv = 0; cv < 4; ++cv)
+					if (auto type = make_basic_type((::CXTypeKind)k))
+					{
+						type->constQualified = cv & 1;
+						type->volatileQualified = cv & 2;
+						flyweights[k * 4 + cv] = type;
+					}
+			return flyweights;
+		}();
+
+		if ((size_t)kind >= maxKind)
+			return nullptr;
+		return flyweights[(size_t)kind * 4 + (constQualified ? 1 : 0) + (volatileQualified ? 2 : 0)];
+	}
+
+	DocumentationString::DocumentationString(const CommentRange& range, string raw) :
+		range(range),
+		m_resolved(std::make_shared<Resolved>(Resolved{ std::move(raw), std::nullopt }))
+	{
+	}
+
+	DocumentationString::Resolved& DocumentationString::resolved() const
+	{
+		if (!m_resolved)
+			m_resolved = std::make_shared<Resolved>(Resolved{ read_comment(this->range), std::nullopt });
+		return *m_resolved;
+	}
+
+	const ParsedComment& DocumentationString::parsed() const
+	{
+		Resolved& resolved = this->resolved();
+		if (!resolved.parsed)
+			resolved.parsed = parse_comment(resolved.raw);
+		return *resolved.parsed;
+	}
+
+	string DocumentationString::text() const
+	{
+		return m_resolved ? m_resolved->raw : read_comment(this->range);
+	}
+
+	void Symbol::merge(const Symbol& other)
+	{
+		this->exposed = this->exposed || other.exposed;
+		this->declarations.insert(other.declarations.begin(), other.declarations.end());
+		this->definitions.insert(other.definitions.begin(), other.definitions.end());
+		this->docStr.merge(other.docStr);
+	}
+
+	void SymbolRegistry::add(const shared_ptr<Symbol>& symbol)
+	{
+		if (!symbol)
+			return;
+
+		const size_t size = this->symbols.size();
+		this->symbols.insert(symbol);
+		if (this->symbols.size() > size)
+			this->index(*symbol);
+		else
+			// replaced, possibly by a symbol of another kind
+			this->reindex();
+	}
+
+	void SymbolRegistry::index(const Symbol& symbol)
+	{
+		m_byKind[(size_t)symbol.kind()].push_back(symbol.index());
+		m_children[symbol.parentIndex].push_back(symbol.index());
+		this->indexFiles(symbol, {});
+	}
+
+	void SymbolRegistry::indexFiles(const Symbol& symbol, const set<InternedString>& known)
+	{
+		for (const auto& file : files_of(symbol))
+			if (!known.contains(file))
+				m_byFile[file].push_back(symbol.index());
+	}
+
+	void SymbolRegistry::reindex()
+	{
+		for (auto& kind : m_byKind)
+			kind.clear();
+		m_children.clear();
+		m_byFile.clear();
+
+		for (const auto& symbol : this->symbols)
+			this->index(*symbol);
+	}
+
+	SymbolId SymbolRegistry::id(const Symbol& symbol) const
+	{
+		SymbolId id;
+		for (const Symbol* s = &symbol; s; )
+		{
+			id.push_back(s->idPart());
+			const auto parent = this->parentOf(*s);
+			s = parent.get();
+		}
+		std::reverse(id.begin(), id.end());
+		return id;
+	}
+
+	void SymbolRegistry::merge(SymbolRegistry&& other)
+	{
+		this->mergeSymbols(other);
+		this->unhandledDecls.splice(this->unhandledDecls.end(), other.unhandledDecls);
+		other.symbols.clear();
+		other.types = {};
+	}
+
+	void SymbolRegistry::merge(const SymbolRegistry& other)
+	{
+		this->mergeSymbols(other);
+		this->unhandledDecls.insert(this->unhandledDecls.end(), other.unhandledDecls.begin(), other.unhandledDecls.end());
+	}
+
+	void SymbolRegistry::mergeSymbols(const SymbolRegistry& other)
+	{
+		vector<shared_ptr<Symbol>> adopted;
+
+		for (const auto& symbol : other.symbols)
+		{
+			if (auto existing = this->symbols.find(symbol->usr()))
+			{
+				const auto known = files_of(*existing);
+				existing->merge(*symbol);
+				this->indexFiles(*existing, known);
+			}
+			else
+			{
+				// copied to the arena of this registry, so that the arena of `other` is not kept alive
+				auto copy = make_like(*symbol, this->arena);
+				assign(*copy, *symbol);
+				adopted.push_back(copy);
+				this->symbols.insert(copy);
+			}
+		}
+
+		TypeImporter import(*this, other);
+		for (const auto& [key, type] : other.types.entries())
+			import(type);
+
+		for (const auto& symbol : adopted)
+		{
+			relink(*symbol, import, *this);
+			this->index(*symbol);
+		}
+	}
+
+	void SymbolRegistry::refresh(const set<string>& usrs, const vector<const SymbolRegistry*>& contributions)
+	{
+		// each refreshed symbol is relinked with the types of the contribution it has been copied from
+		vector<std::pair<shared_ptr<Symbol>, const SymbolRegistry*>> refreshed;
+		set<string> removed;
+
+		for (const auto& usr : usrs)
+		{
+			shared_ptr<Symbol> result;
+			const SymbolRegistry* source = nullptr;
+
+			for (const SymbolRegistry* contribution : contributions)
+			{
+				const auto symbol = contribution->find(usr);
+				if (!symbol)
+					continue;
+
+				if (result)
+				{
+					result->merge(*symbol);
+					continue;
+				}
+
+				// the existing object is reused, so that the other symbols referencing it see the update
+				auto existing = this->symbols.find(usr);
+				if (existing && typeid(*existing) == typeid(*symbol))
+					result = existing;
+				else
+					result = make_like(*symbol, this->arena);
+				assign(*result, *symbol);
+				source = contribution;
+			}
+
+			if (result)
+			{
+				this->symbols.insert(result);
+				refreshed.emplace_back(result, source);
+			}
+			else
+				removed.insert(usr);
+		}
+
+		std::map<const SymbolRegistry*, TypeImporter> importers;
+		for (const auto& [symbol, source] : refreshed)
+		{
+			auto it = importers.find(source);
+			if (it == importers.end())
+				it = importers.emplace(std::piecewise_construct, std::forward_as_tuple(source), std::forward_as_tuple(*this, *source)).first;
+			relink(*symbol, it->second, *this);
+		}
+
+		// after relinking, the parent indices of the refreshed symbols refer to this registry
+		this->symbols.erase(removed);
+		this->reindex();
+	}
+
+	ConcurrentSymbolRegistry::ConcurrentSymbolRegistry(size_t shards) :
+		m_shards(std::bit_ceil(std::max<size_t>(shards, 1)))
+	{
+	}
+
+	ConcurrentSymbolRegistry::Shard& ConcurrentSymbolRegistry::shardOf(std::string_view usr)
+	{
+		return m_shards[hash_bytes(usr) & (m_shards.size() - 1)];
+	}
+
+	shared_ptr<Symbol> ConcurrentSymbolRegistry::canonical(const shared_ptr<Symbol>& symbol)
+	{
+		if (!symbol)
+			return nullptr;
+
+		Shard& shard = this->shardOf(symbol->usr());
+		std::lock_guard lock(shard.mutex);
+		const auto it = shard.entries.find(symbol->internedUsr().handle());
+		return it != shard.entries.end() ? it->second.symbol : symbol;
+	}
+
+	void ConcurrentSymbolRegistry::merge(uint32_t unit, SymbolRegistry&& registry)
+	{
+		// the longest comment, the one of the first unit on ties: the result of merging in unit order
+		const auto keepsComment = [](const DocumentationString& current, uint32_t currentUnit, const DocumentationString& other, uint32_t otherUnit) {
+			if (other.range.size() != current.range.size())
+				return other.range.size() < current.range.size();
+			return currentUnit <= otherUnit;
+		};
+
+		// the merged symbols this unit provides, with the symbol of the unit they come from
+		vector<std::pair<shared_ptr<Symbol>, shared_ptr<Symbol>>> provided;
+
+		uint32_t position = 0;
+		for (const auto& symbol : registry.symbols)
+		{
+			const auto parent = registry.parentOf(*symbol);
+			const InternedString parentUsr = parent ? parent->internedUsr() : InternedString();
+
+			Shard& shard = this->shardOf(symbol->usr());
+			std::lock_guard lock(shard.mutex);
+
+			const auto [it, inserted] = shard.entries.try_emplace(symbol->internedUsr().handle());
+			Entry& entry = it->second;
+			if (inserted)
+			{
+				auto copy = make_like(*symbol, shard.arena);
+				assign(*copy, *symbol);
+				entry = Entry{ copy, unit, position++, unit, parentUsr };
+				provided.emplace_back(copy, symbol);
+				continue;
+			}
+
+			const bool keepComment = keepsComment(entry.symbol->docStr, entry.docUnit, symbol->docStr, unit);
+			DocumentationString comment = keepComment ? entry.symbol->docStr : symbol->docStr;
+			const uint32_t docUnit = keepComment ? entry.docUnit : unit;
+
+			if (unit < entry.unit)
+			{
+				// an earlier unit provides the symbol itself, the locations found so far are kept.
+				// The object is reused, unless the kind changes: collect() relinks the types referencing the old one
+				const auto previous = entry.symbol;
+				auto merged = typeid(*previous) == typeid(*symbol) ? previous : make_like(*symbol, shard.arena);
+				auto declarations = std::move(previous->declarations);
+				auto definitions = std::move(previous->definitions);
+				const bool exposed = previous->exposed;
+
+				assign(*merged, *symbol);
+				merged->declarations.merge(declarations);
+				merged->definitions.merge(definitions);
+				merged->exposed = merged->exposed || exposed;
+
+				entry = Entry{ merged, unit, position, unit, parentUsr };
+				provided.emplace_back(merged, symbol);
+			}
+			else
+				entry.symbol->merge(*symbol);
+
+			entry.symbol->docStr = std::move(comment);
+			entry.docUnit = docUnit;
+			++position;
+		}
+
+		{
+			std::lock_guard lock(m_mutex);
+			m_unhandledDecls[unit].splice(m_unhandledDecls[unit].end(), registry.unhandledDecls);
+
+			// the types of the unit are imported, relinked to the merged symbols, and set on the symbols
+			// of the unit: these are only read by this thread
+			TypeImporter import(m_types, [this](const shared_ptr<Symbol>& symbol) { return this->canonical(symbol); }, registry);
+			for (const auto& [key, type] : registry.types.entries())
+				import(type);
+			for (const auto& [merged, symbol] : provided)
+				relink_types(*symbol, import);
+		}
+
+		// then copied to the merged symbols, unless an earlier unit has provided them in the meantime
+		for (const auto& [merged, symbol] : provided)
+		{
+			Shard& shard = this->shardOf(symbol->usr());
+			std::lock_guard lock(shard.mutex);
+			const auto it = shard.entries.find(symbol->internedUsr().handle());
+			if (it != shard.entries.end() && it->second.symbol == merged && it->second.unit == unit)
+				assign_types(*merged, *symbol);
+		}
+
+		// nothing references the symbols of the unit anymore, its arena is released with them
+		registry.symbols.clear();
+		registry.types = {};
+	}
+
+	SymbolRegistry ConcurrentSymbolRegistry::collect()
+	{
+		vector<Entry> entries;
+		for (auto& shard : m_shards)
+		{
+			for (auto& [usr, entry] : shard.entries)
+				entries.push_back(std::move(entry));
+			shard.entries.clear();
+			// the collected symbols keep the previous one alive
+			shard.arena = std::make_shared<SymbolArena>();
+		}
+		std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+			return std::tie(a.unit, a.position) < std::tie(b.unit, b.position);
+		});
+
+		SymbolRegistry registry;
+		for (const auto& entry : entries)
+			registry.symbols.insert(entry.symbol);
+
+		// the parents come first in their unit, or from an earlier one
+		for (const auto& entry : entries)
+		{
+			const auto parent = entry.parentUsr.empty() ? nullptr : registry.find(entry.parentUsr.str());
+			entry.symbol->parentIndex = parent ? parent->index() : no_symbol;
+		}
+
+		// the types only need a new node where they reference a symbol replaced by one of another kind
+		SymbolRegistry source;
+		source.types = std::move(m_types);
+		m_types = {};
+		TypeImporter import(registry, source);
+		for (const auto& [key, type] : source.types.entries())
+			import(type);
+		for (const auto& entry : entries)
+			relink_types(*entry.symbol, import);
+
+		for (auto& [unit, decls] : m_unhandledDecls)
+			registry.unhandledDecls.splice(registry.unhandledDecls.end(), decls);
+		m_unhandledDecls.clear();
+
+		registry.reindex();
+		return registry;
+	}
+}
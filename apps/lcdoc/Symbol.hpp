@@ -9,9 +9,20 @@
 #include <concepts>
 #include <set>
 #include <list>
+#include <functional>
+#include <unordered_map>
+#include <string_view>
+#include <span>
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <optional>
 
 // !!!
 #include "string_utils.hpp"
+#include "StringPool.hpp"
+#include "doc_comment.hpp"
+#include "SymbolArena.hpp"
 #include "clang-c/Index.h"
 
 namespace lcdoc
@@ -24,6 +35,7 @@ namespace lcdoc
 	using std::unique_ptr;
 	using std::shared_ptr;
 	using std::weak_ptr;
+	using std::optional;
 	using std::filesystem::path;
 
 	class SymbolRegistry;
@@ -32,23 +44,60 @@ namespace lcdoc
 	class EnumSymbol;
 	class TypedefSymbol;
 
+	// The doc comment of a symbol. Only its range is recorded while parsing: the text is read from the
+	// source and parsed the first time a renderer asks for it, then cached (not thread safe, the
+	// documentation is generated from a single thread).
+	// A comment loaded from a serialized registry comes with its text, the source may have changed since.
 	class DocumentationString
 	{
 	public:
-		string brief;
-		string raw;
+
+		DocumentationString() = default;
+		explicit DocumentationString(const CommentRange& range) : range(range) {}
+		DocumentationString(const CommentRange& range, string raw);
+
+		CommentRange range;
+
+		// the longest comment wins
+		void merge(const DocumentationString& other) {
+			if (other.range.size() > this->range.size())
+				*this = other;
+		}
+
+		const string& raw() const { return this->resolved().raw; }
+		const ParsedComment& parsed() const;
+		const string& brief() const { return this->parsed().brief; }
+
+		// the raw text, without keeping it if it has not been read yet, e.g. to serialize the comment
+		string text() const;
+
+	private:
+
+		struct Resolved
+		{
+			string raw;
+			optional<ParsedComment> parsed;
+		};
+
+		Resolved& resolved() const;
+
+		// shared by the copies of the symbol
+		mutable shared_ptr<Resolved> m_resolved;
 	};
 
 	struct Location
 	{
-		path fileName;
+		InternedString file;
 		int line = 0;
 		int column = 0;
 		int offset = 0;
 
+		path fileName() const { return path(this->file.str()); }
+
 		bool operator==(const Location&) const = default;
+		std::strong_ordering operator<=>(const Location&) const = default;
 
-		operator bool() const { return *this == Location(); }
+		explicit operator bool() const { return !(*this == Location()); }
 	};
 
 	class Type // abstract
@@ -92,7 +141,7 @@ namespace lcdoc
 		}
 
 		std::shared_ptr<TypedefSymbol> symbol;
-		string typedefName;
+		InternedString typedefName;
 
 	private:
 	};
@@ -151,15 +200,20 @@ namespace lcdoc
 	{
 	public:
 
+		virtual ::CXTypeKind kind() const = 0;
+
 	private:
 	};
 
+	// creates the basic type corresponding to `kind`, nullptr if `kind` is not a basic type
+	shared_ptr<BasicCXXType> make_basic_type(::CXTypeKind kind);
+
 	namespace basic_types
 	{
 		template <::CXTypeKind _kind> struct get_basic_type;
 
-#define lc_tmp_declare_basic(kind, name, str) class name final : public BasicCXXType { public: string spelling() const override { return str; } }; template <> struct get_basic_type<kind> { using type = name; };
-#define lc_tmp_declare_basic_keyword(kind, name, str) class name final : public BasicCXXType, public KeywordType { public: string spelling() const override { return str; } }; template <> struct get_basic_type<kind> { using type = name; };
+#define lc_tmp_declare_basic(cx_kind, name, str) class name final : public BasicCXXType { public: string spelling() const override { return str; } ::CXTypeKind kind() const override { return cx_kind; } }; template <> struct get_basic_type<cx_kind> { using type = name; };
+#define lc_tmp_declare_basic_keyword(cx_kind, name, str) class name final : public BasicCXXType, public KeywordType { public: string spelling() const override { return str; } ::CXTypeKind kind() const override { return cx_kind; } }; template <> struct get_basic_type<cx_kind> { using type = name; };
 #define lc_tmp_decl_unhandled(cx_type) lc_tmp_declare_basic(cx_type,cx_type##_Type,#cx_type)
 
 		// CXType_Invalid   -> UnexposedType
@@ -289,26 +343,21 @@ namespace lcdoc
 #undef tmp_decl_unhandled
 	}
 
-	struct SymbolIdPart : string
+	struct SymbolIdPart
 	{
-		using string::string;
+		InternedString id;
+		InternedString spelling;
+		InternedString display;
 
-		SymbolIdPart(const string& id, const string& spelling, const string& display) :
-			string(id),
-			spelling(spelling),
-			display(display)
-		{
-		}
+		bool empty() const { return this->id.empty(); }
 
-		string spelling;
-		string display;
-
-		constexpr std::strong_ordering operator<=>(const SymbolIdPart& other) const {
+		bool operator==(const SymbolIdPart&) const = default;
+		std::strong_ordering operator<=>(const SymbolIdPart& other) const {
 			if (this->display != other.display)
 				return this->display <=> other.display;
 			if (this->spelling != other.spelling)
 				return this->spelling <=> other.spelling;
-			return ((const string&)*this) <=> ((const string&)other);
+			return this->id <=> other.id;
 		}
 	};
 
@@ -335,7 +384,7 @@ namespace lcdoc
 		constexpr string to_string() const {
 			vector<string> ss;
 			for (const auto& part : *this)
-				ss.push_back(part);
+				ss.push_back(part.id);
 			return join(ss, "::");
 		}
 
@@ -369,20 +418,40 @@ namespace lcdoc
 		}
 	};
 
+	// index of a symbol in its registry, or no symbol
+	inline constexpr uint32_t no_symbol = ~uint32_t(0);
+
+	// the concrete class of a symbol
+	enum class SymbolKind : uint8_t
+	{
+		UnexposedDeclaration,
+		Typedef,
+		Namespace,
+		Enum,
+		Function,
+		StructLike,
+		Struct,
+		Class,
+	};
+
+	inline constexpr size_t symbol_kind_count = (size_t)SymbolKind::Class + 1;
+
 	class Symbol
 	{
 	public:
 
-		Symbol(const SymbolIdPart& idPart) : m_idPart(idPart) {}
+		Symbol(const SymbolIdPart& idPart, InternedString usr = {}) : m_idPart(idPart), m_usr(usr) {}
 
 		virtual ~Symbol() = default;
 
 		virtual string kindSpelling() const = 0;
 
+		virtual SymbolKind kind() const = 0;
+
 		DocumentationString docStr;
 
-		string spelling;
-		string displayName;
+		InternedString spelling;
+		InternedString displayName;
 		//string canonicalSpelling;
 
 		set<Location> declarations;
@@ -394,18 +463,32 @@ namespace lcdoc
 			return m_idPart;
 		}
 
-		SymbolId id() const {
-			SymbolId id;
-			if (auto parent = this->parent.lock())
-				id = parent->id();
-			id.push_back(this->idPart());
-			return id;
+		// the clang USR, identifies the symbol in the registry
+		const string& usr() const {
+			return m_usr;
+		}
+
+		InternedString internedUsr() const {
+			return m_usr;
 		}
 
-		weak_ptr<Symbol> parent;
+		// position of the symbol in the registry owning it
+		uint32_t index() const {
+			return m_index;
+		}
+
+		// position of the parent in the same registry, no_symbol for top level symbols
+		uint32_t parentIndex = no_symbol;
+
+		// merges the declarations, definitions and documentation of the same symbol found in another translation unit
+		void merge(const Symbol& other);
 
 	private:
+		friend class SymbolIndex;
+
 		const SymbolIdPart m_idPart;
+		const InternedString m_usr;
+		uint32_t m_index = no_symbol;
 	};
 
 	class CXXSymbol : public Symbol
@@ -424,6 +507,7 @@ namespace lcdoc
 		using CXXSymbol::CXXSymbol;
 
 		string kindSpelling() const override { return "<-unexposed->"; };
+		SymbolKind kind() const override { return SymbolKind::UnexposedDeclaration; }
 	};
 
 	class TypedefSymbol : public CXXSymbol
@@ -432,6 +516,7 @@ namespace lcdoc
 		using CXXSymbol::CXXSymbol;
 
 		string kindSpelling() const override { return "<typedef-symbol>"; };
+		SymbolKind kind() const override { return SymbolKind::Typedef; }
 
 		shared_ptr<CXXType> underlying;
 	};
@@ -443,6 +528,7 @@ namespace lcdoc
 		using CXXSymbol::CXXSymbol;
 
 		string kindSpelling() const override { return "<namespace>"; };
+		SymbolKind kind() const override { return SymbolKind::Namespace; }
 
 	private:
 
@@ -455,6 +541,7 @@ namespace lcdoc
 		using CXXSymbol::CXXSymbol;
 
 		string kindSpelling() const override { return "<enum-symbol>"; };
+		SymbolKind kind() const override { return SymbolKind::Enum; }
 
 		bool scoped = false;
 
@@ -465,7 +552,7 @@ namespace lcdoc
 	struct FuncArg
 	{
 		shared_ptr<Type> type;
-		string name;
+		InternedString name;
 	};
 
 	struct FunctionSignature
@@ -481,6 +568,7 @@ namespace lcdoc
 		using CXXSymbol::CXXSymbol;
 
 		string kindSpelling() const override { return "<function>"; };
+		SymbolKind kind() const override { return SymbolKind::Function; }
 
 		//string name;
 		string mangling;
@@ -495,6 +583,7 @@ namespace lcdoc
 		using CXXSymbol::CXXSymbol;
 
 		string kindSpelling() const override { return "<struct-like>"; };
+		SymbolKind kind() const override { return SymbolKind::StructLike; }
 	};
 
 	class StructSymbol : public StructLikeSymbol
@@ -504,6 +593,7 @@ namespace lcdoc
 		using StructLikeSymbol::StructLikeSymbol;
 
 		string kindSpelling() const override { return "<struct>"; };
+		SymbolKind kind() const override { return SymbolKind::Struct; }
 
 	private:
 	};
@@ -515,10 +605,140 @@ namespace lcdoc
 		using StructLikeSymbol::StructLikeSymbol;
 
 		string kindSpelling() const override { return "<class>"; };
+		SymbolKind kind() const override { return SymbolKind::Class; }
+
+	private:
+	};
+
+	// The symbols of a registry, indexed by USR with an open addressing hash table.
+	// Iteration follows the insertion order, lookups do not allocate.
+	class SymbolIndex
+	{
+	public:
+
+		using const_iterator = vector<shared_ptr<Symbol>>::const_iterator;
+
+		shared_ptr<Symbol> find(std::string_view usr) const {
+			if (m_slots.empty())
+				return nullptr;
+			const Slot& slot = m_slots[this->slotOf(usr, hash_usr(usr))];
+			if (slot.index == empty_index)
+				return nullptr;
+			return m_symbols[slot.index];
+		}
+
+		bool contains(std::string_view usr) const {
+			return (bool)this->find(usr);
+		}
+
+		const shared_ptr<Symbol>& at(uint32_t index) const {
+			return m_symbols.at(index);
+		}
+
+		// true if `symbol` is the one stored at its index
+		bool owns(const Symbol& symbol) const {
+			return symbol.m_index < m_symbols.size() && m_symbols[symbol.m_index].get() == &symbol;
+		}
+
+		// adds the symbol, replacing the one with the same USR in place
+		void insert(const shared_ptr<Symbol>& symbol);
+
+		// removes the symbols with the given USRs, the order of the others is kept
+		// and their parent indices are updated
+		void erase(const set<string>& usrs);
+
+		void clear() {
+			m_symbols.clear();
+			m_slots.clear();
+		}
+
+		size_t size() const { return m_symbols.size(); }
+		bool empty() const { return m_symbols.empty(); }
+
+		const_iterator begin() const { return m_symbols.begin(); }
+		const_iterator end() const { return m_symbols.end(); }
+
+	private:
+
+		static constexpr uint32_t empty_index = no_symbol;
+
+		struct Slot
+		{
+			uint64_t hash = 0;
+			uint32_t index = empty_index;
+		};
+
+		static uint64_t hash_usr(std::string_view usr);
+
+		// the slot holding `usr`, or the empty slot where it would be inserted
+		size_t slotOf(std::string_view usr, uint64_t hash) const;
+
+		void rehash(size_t capacity);
+
+		vector<shared_ptr<Symbol>> m_symbols;
+		vector<Slot> m_slots; // power of two size, at most half full
+	};
+
+	// Hash consing of the types of a registry: structurally equal types share the same node.
+	// The basic types are flyweights shared by all the registries.
+	// Interned types are never modified after being added.
+	class TypeInterner
+	{
+	public:
+
+		struct Key
+		{
+			::CXTypeKind kind = ::CXType_Invalid;
+			bool constQualified = false;
+			bool volatileQualified = false;
+			InternedString spelling;
+			InternedString canonicalSpelling;
+			// the USR of the declaration the type names, if any: the spellings are not scoped,
+			// a::T and b::T both spell T
+			InternedString declaration;
+
+			bool operator==(const Key&) const = default;
+		};
+
+		struct KeyHash
+		{
+			size_t operator()(const Key& key) const {
+				size_t hash = key.spelling.handle();
+				hash = hash * 31 + key.canonicalSpelling.handle();
+				hash = hash * 31 + key.declaration.handle();
+				return hash * 31 + (((size_t)key.kind << 2) | ((size_t)key.constQualified << 1) | (size_t)key.volatileQualified);
+			}
+		};
+
+		shared_ptr<CXXType> find(const Key& key) const {
+			auto it = m_types.find(key);
+			if (it != m_types.end())
+				return it->second;
+			return nullptr;
+		}
+
+		void add(const Key& key, const shared_ptr<CXXType>& type) {
+			if (type)
+				m_types.emplace(key, type);
+		}
+
+		const std::unordered_map<Key, shared_ptr<CXXType>, KeyHash>& entries() const {
+			return m_types;
+		}
+
+		// the shared instance of a basic type, nullptr if `kind` is not a basic type
+		static shared_ptr<CXXType> basic(::CXTypeKind kind, bool constQualified, bool volatileQualified);
 
 	private:
+		std::unordered_map<Key, shared_ptr<CXXType>, KeyHash> m_types;
 	};
 
+	// creates a symbol in `arena`, the symbol keeps the arena alive
+	template <std::derived_from<Symbol> T, typename... Args>
+	shared_ptr<T> make_symbol_in(const shared_ptr<SymbolArena>& arena, Args&&... args) {
+		return std::allocate_shared<T>(ArenaAllocator<T>(arena), std::forward<Args>(args)...);
+	}
+
 	class SymbolRegistry
 	{
 	public:
@@ -528,22 +748,137 @@ namespace lcdoc
 			Location location;
 		};
 
-		map<SymbolId, shared_ptr<Symbol>> symbolsById;
+		// the symbols of the registry are allocated here, every symbol keeps it alive
+		shared_ptr<SymbolArena> arena = std::make_shared<SymbolArena>();
+
+		SymbolIndex symbols;
 		list<UnhandledDecl> unhandledDecls;
+		TypeInterner types;
 
-		void add(const shared_ptr<Symbol>& symbol) {
-			if (symbol)
-				this->symbolsById[symbol->id()] = symbol;
+		// creates a symbol in the arena of the registry, without adding it
+		template <std::derived_from<Symbol> T, typename... Args>
+		shared_ptr<T> make(Args&&... args) {
+			return make_symbol_in<T>(this->arena, std::forward<Args>(args)...);
 		}
 
-		shared_ptr<Symbol> findFromId(const SymbolId& id) const {
-			auto it = this->symbolsById.find(id);
-			if (it != this->symbolsById.end())
-				return it->second;
-			return nullptr;
+		// adds the symbol and indexes it, its parent index and locations must already be set
+		void add(const shared_ptr<Symbol>& symbol);
+
+		shared_ptr<Symbol> find(std::string_view usr) const {
+			return this->symbols.find(usr);
+		}
+
+		// nullptr for top level symbols and for symbols of other registries
+		shared_ptr<Symbol> parentOf(const Symbol& symbol) const {
+			if (symbol.parentIndex == no_symbol || !this->symbols.owns(symbol))
+				return nullptr;
+			return this->symbols.at(symbol.parentIndex);
+		}
+
+		// human readable id, built from the parents: only meant for rendering
+		SymbolId id(const Symbol& symbol) const;
+
+		// Secondary indexes, as positions in `symbols`, maintained while recording and merging.
+		// The symbols of a kind and the ones declared in a file are in insertion order.
+		std::span<const uint32_t> ofKind(SymbolKind kind) const {
+			return m_byKind[(size_t)kind];
+		}
+
+		// the top level symbols for no_symbol
+		std::span<const uint32_t> childrenOf(uint32_t parent) const {
+			auto it = m_children.find(parent);
+			return it != m_children.end() ? std::span<const uint32_t>(it->second) : std::span<const uint32_t>();
+		}
+
+		// symbols declared or defined in `file`
+		std::span<const uint32_t> declaredIn(InternedString file) const {
+			auto it = m_byFile.find(file);
+			return it != m_byFile.end() ? std::span<const uint32_t>(it->second) : std::span<const uint32_t>();
+		}
+
+		const std::unordered_map<InternedString, vector<uint32_t>>& files() const {
+			return m_byFile;
 		}
 
+		// rebuilds the secondary indexes from scratch
+		void reindex();
+
+		// Moves all the symbols of `other` into this registry.
+		// Symbols already present are merged with Symbol::merge, new symbols are copied to the arena of this
+		// registry and their parents and type references are relinked to the symbols of this registry.
+		// The result only depends on the order of the merges, not on how the registries were produced.
+		void merge(SymbolRegistry&& other);
+
+		// Same as merge(SymbolRegistry&&), but `other` is left as is.
+		void merge(const SymbolRegistry& other);
+
+		// Rebuilds the symbols with the given USRs from the registries of all the translation units,
+		// in order, as a sequence of merges would. The contributions are not modified.
+		// Existing symbols are updated in place, symbols no longer found are removed.
+		void refresh(const set<string>& usrs, const vector<const SymbolRegistry*>& contributions);
+
 	private:
 
+		void mergeSymbols(const SymbolRegistry& other);
+
+		void index(const Symbol& symbol);
+		void indexFiles(const Symbol& symbol, const set<InternedString>& known);
+
+		std::array<vector<uint32_t>, symbol_kind_count> m_byKind;
+		std::unordered_map<uint32_t, vector<uint32_t>> m_children;
+		std::unordered_map<InternedString, vector<uint32_t>> m_byFile;
+	};
+
+	// A registry the parsing threads merge their translation units into as soon as they are parsed, so that the
+	// symbols of the shared headers are deduplicated on arrival rather than kept once per unit until the end.
+	// The symbols are spread over lock-striped shards by USR hash. Each symbol remembers the first unit it comes
+	// from: whatever the arrival order, collect() gives the symbols, in the order, that merging the units in
+	// unit order with SymbolRegistry::merge would give (the longest comment wins, the first unit on ties).
+	// The symbols are copied to the arenas of the shards and the types are imported on arrival:
+	// nothing of a merged unit is kept.
+	class ConcurrentSymbolRegistry
+	{
+	public:
+
+		explicit ConcurrentSymbolRegistry(size_t shards = 64);
+
+		ConcurrentSymbolRegistry(const ConcurrentSymbolRegistry&) = delete;
+		ConcurrentSymbolRegistry& operator=(const ConcurrentSymbolRegistry&) = delete;
+
+		// thread safe, `unit` is the position of the translation unit in the merge order
+		void merge(uint32_t unit, SymbolRegistry&& registry);
+
+		// the merged registry, once all the merges are over. The registry is then empty
+		SymbolRegistry collect();
+
+	private:
+
+		struct Entry
+		{
+			// the symbol of the first unit, with the contributions of the others merged in
+			shared_ptr<Symbol> symbol;
+			uint32_t unit = 0;
+			uint32_t position = 0; // in the registry of `unit`
+			uint32_t docUnit = 0; // the unit of the comment kept
+			InternedString parentUsr;
+		};
+
+		struct Shard
+		{
+			std::mutex mutex;
+			shared_ptr<SymbolArena> arena = std::make_shared<SymbolArena>();
+			std::unordered_map<uint32_t, Entry> entries; // by USR handle
+		};
+
+		Shard& shardOf(std::string_view usr);
+
+		// the merged symbol with the USR of `symbol`, `symbol` itself if there is none
+		shared_ptr<Symbol> canonical(const shared_ptr<Symbol>& symbol);
+
+		vector<Shard> m_shards;
+
+		std::mutex m_mutex;
+		TypeInterner m_types; // the types of all the units, relinked to the merged symbols
+		map<uint32_t, list<SymbolRegistry::UnhandledDecl>> m_unhandledDecls;
 	};
-}
\ No newline at end of file
+}
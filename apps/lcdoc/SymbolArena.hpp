@@ -0,0 +1,87 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace lcdoc
+{
+	// Bump allocator for the symbols of a registry: memory is taken from large blocks
+	// and only released when the arena is destroyed. Not thread safe, a registry is filled by one thread.
+	class SymbolArena
+	{
+	public:
+
+		static constexpr size_t default_block_size = 64 * 1024;
+
+		explicit SymbolArena(size_t blockSize = default_block_size) : m_blockSize(blockSize) {}
+		SymbolArena(const SymbolArena&) = delete;
+		SymbolArena& operator=(const SymbolArena&) = delete;
+
+		void* allocate(size_t size, size_t alignment) {
+			std::byte* p = align(m_cursor, alignment);
+			if (!p || p + size > m_end)
+			{
+				const size_t blockSize = std::max(m_blockSize, size + alignment);
+				m_blocks.push_back(std::make_unique<std::byte[]>(blockSize));
+				m_cursor = m_blocks.back().get();
+				m_end = m_cursor + blockSize;
+				m_reserved += blockSize;
+				p = align(m_cursor, alignment);
+			}
+			m_cursor = p + size;
+			return p;
+		}
+
+		// bytes reserved from the system
+		size_t reserved() const { return m_reserved; }
+
+	private:
+
+		static std::byte* align(std::byte* p, size_t alignment) {
+			if (!p)
+				return nullptr;
+			const auto address = reinterpret_cast<std::uintptr_t>(p);
+			return p + ((alignment - address % alignment) % alignment);
+		}
+
+		size_t m_blockSize;
+		std::vector<std::unique_ptr<std::byte[]>> m_blocks;
+		std::byte* m_cursor = nullptr;
+		std::byte* m_end = nullptr;
+		size_t m_reserved = 0;
+	};
+
+	// Allocator for std::allocate_shared: the symbol and its control block share one arena slot,
+	// and every symbol keeps its arena alive.
+	template <typename T>
+	class ArenaAllocator
+	{
+	public:
+
+		using value_type = T;
+
+		explicit ArenaAllocator(std::shared_ptr<SymbolArena> arena) : m_arena(std::move(arena)) {}
+
+		template <typename U>
+		ArenaAllocator(const ArenaAllocator<U>& other) : m_arena(other.arena()) {}
+
+		T* allocate(size_t n) {
+			return static_cast<T*>(m_arena->allocate(n * sizeof(T), alignof(T)));
+		}
+
+		void deallocate(T*, size_t) {
+			// released with the arena
+		}
+
+		const std::shared_ptr<SymbolArena>& arena() const { return m_arena; }
+
+		template <typename U>
+		bool operator==(const ArenaAllocator<U>& other) const { return m_arena == other.arena(); }
+
+	private:
+		std::shared_ptr<SymbolArena> m_arena;
+	};
+}
@@ -0,0 +1,132 @@
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <random>
+
+#include "hash.hpp"
+#include "binary_io.hpp"
+#include "registry_io.hpp"
+
+#include "SymbolCache.hpp"
+
+namespace lcdoc
+{
+	namespace
+	{
+		constexpr uint32_t entry_magic = 0x4344434c; // "LCDC"
+	}
+
+	SymbolCache::SymbolCache(const path& dir, uint64_t extraction) :
+		m_dir(dir),
+		m_extraction(extraction)
+	{
+		std::filesystem::create_directories(m_dir);
+	}
+
+	optional<SymbolRegistry> SymbolCache::load(const path& source, const vector<string>& args, unsigned flags)
+	{
+		const path entry = this->entryPath(source, args, flags);
+		if (entry.empty() || !std::filesystem::is_regular_file(entry))
+			return std::nullopt;
+
+		try
+		{
+			std::ifstream in(entry, std::ios::binary);
+			BinaryReader r(in);
+
+			if (r.u32() != entry_magic || r.u32() != registry_format_version)
+				return std::nullopt;
+
+			for (uint32_t n = r.u32(); n > 0; --n)
+			{
+				const path file = r.str();
+				const uint64_t hash = r.u64();
+				if (this->fileHash(file) != hash)
+					return std::nullopt;
+			}
+
+			return read_registry(in);
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << "ignoring corrupted cache entry " << entry << ": " << e.what() << std::endl;
+			return std::nullopt;
+		}
+	}
+
+	void SymbolCache::store(const path& source, const vector<string>& args, unsigned flags, const SymbolRegistry& registry, const vector<path>& includedFiles)
+	{
+		const path entry = this->entryPath(source, args, flags);
+		if (entry.empty())
+			return;
+
+		// written to a temporary file and renamed, so that a concurrent or interrupted run never sees half an entry
+		// the thread id alone is not unique: the forked workers of an isolated parse can all have the same.
+		// A random suffix, drawn for each entry since a value drawn before a fork is shared by the workers
+		path tmp = entry;
+		tmp += std::format(".{}.{:08x}.tmp", std::hash<std::thread::id>()(std::this_thread::get_id()), std::random_device()());
+		{
+			std::ofstream out(tmp, std::ios::binary);
+			BinaryWriter w(out);
+
+			w.u32(entry_magic);
+			w.u32(registry_format_version);
+
+			vector<std::pair<path, uint64_t>> dependencies;
+			for (const auto& file : includedFiles)
+				if (const auto hash = this->fileHash(file))
+					dependencies.emplace_back(file, *hash);
+
+			w.u32((uint32_t)dependencies.size());
+			for (const auto& [file, hash] : dependencies)
+			{
+				w.str(file.string());
+				w.u64(hash);
+			}
+
+			write_registry(out, registry);
+
+			if (!out)
+			{
+				std::cerr << "could not write cache entry " << entry << std::endl;
+				return;
+			}
+		}
+
+		std::error_code ec;
+		std::filesystem::rename(tmp, entry, ec);
+		if (ec)
+			std::filesystem::remove(tmp, ec);
+	}
+
+	path SymbolCache::entryPath(const path& source, const vector<string>& args, unsigned flags)
+	{
+		const auto sourceHash = this->fileHash(source);
+		if (!sourceHash)
+			return {};
+
+		uint64_t key = hash_bytes(std::filesystem::absolute(source).lexically_normal().string());
+		key = hash_combine(key, *sourceHash);
+		for (const auto& arg : args)
+			key = hash_combine(key, hash_bytes(arg));
+		key = hash_combine(key, flags);
+		key = hash_combine(key, m_extraction);
+
+		return m_dir / (to_hex(key) + ".lcdc");
+	}
+
+	optional<uint64_t> SymbolCache::fileHash(const path& file)
+	{
+		{
+			std::lock_guard lock(m_mutex);
+			if (auto it = m_fileHashes.find(file); it != m_fileHashes.end())
+				return it->second;
+		}
+
+		const auto hash = hash_file(file);
+
+		std::lock_guard lock(m_mutex);
+		m_fileHashes[file] = hash;
+		return hash;
+	}
+}
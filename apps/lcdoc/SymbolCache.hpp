@@ -0,0 +1,52 @@
+#pragma once
+
+#include <filesystem>
+#include <optional>
+#include <vector>
+#include <string>
+#include <map>
+#include <mutex>
+
+#include "Symbol.hpp"
+
+namespace lcdoc
+{
+	using std::string;
+	using std::vector;
+	using std::map;
+	using std::optional;
+	using std::filesystem::path;
+
+	// On disk cache of the symbols extracted from each translation unit.
+	// An entry is keyed on the source file path, its content, the clang arguments, the parse flags and the
+	// extraction settings (see ExtractionFilter::hash), and stores the content hash of every included file:
+	// it is valid only if none of them changed.
+	// The cache can be used from several threads at once.
+	class SymbolCache
+	{
+	public:
+
+		SymbolCache(const path& dir, uint64_t extraction = 0);
+
+		// the cached symbols of `source`, nullopt on miss. `flags` are the CXTranslationUnit_Flags of the parse
+		optional<SymbolRegistry> load(const path& source, const vector<string>& args, unsigned flags);
+
+		void store(const path& source, const vector<string>& args, unsigned flags, const SymbolRegistry& registry, const vector<path>& includedFiles);
+
+		const path& dir() const { return m_dir; }
+
+	private:
+
+		path entryPath(const path& source, const vector<string>& args, unsigned flags);
+
+		optional<uint64_t> fileHash(const path& file);
+
+	private:
+		path m_dir;
+		uint64_t m_extraction;
+
+		// hashes are computed once per run, the same headers are checked by many entries
+		std::mutex m_mutex;
+		map<path, optional<uint64_t>> m_fileHashes;
+	};
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <optional>
+#include <cstdint>
+
+namespace lcdoc
+{
+	using std::vector;
+	using std::optional;
+
+	// Hands out the tasks in a given order to several workers, keeping the estimated memory of the
+	// running tasks within a budget: a task that does not fit is passed over by the smaller ones
+	// after it, and runs as soon as enough memory is released. A task larger than the whole budget
+	// runs alone. Can be used from several threads at once.
+	// The tasks without an estimate are assumed to take the average of the known and observed ones of
+	// their group (e.g. the units with the same flags), else of all the tasks, or the whole budget while
+	// nothing is known.
+	class TaskScheduler
+	{
+	public:
+
+		// `memory[i]` is the estimate of the task `i`, nullopt if unknown. A zero `budget` means no limit.
+		// `groups[i]` is the group of the task `i`, no groups if empty
+		TaskScheduler(const vector<size_t>& order, vector<optional<uint64_t>> memory, uint64_t budget, vector<uint32_t> groups = {}) :
+			m_pending(order.begin(), order.end()),
+			m_memory(std::move(memory)),
+			m_charged(m_memory.size(), 0),
+			m_budget(budget),
+			m_groups(std::move(groups))
+		{
+			for (const auto& group : m_groups)
+				if (group >= m_groupKnown.size())
+					m_groupKnown.resize(group + 1);
+
+			for (size_t task = 0; task < m_memory.size(); ++task)
+				if (m_memory[task])
+					this->know(task, (int64_t)*m_memory[task], 1);
+		}
+
+		// the next task that fits in the budget, nullopt when all the tasks are handed out or on cancel().
+		// If `wait` is false, nullopt is also returned when no task fits right now
+		optional<size_t> next(bool wait = true) {
+			std::unique_lock lock(m_mutex);
+			while (true)
+			{
+				if (m_cancelled || m_pending.empty())
+					return std::nullopt;
+
+				for (auto it = m_pending.begin(); it != m_pending.end(); ++it)
+				{
+					const uint64_t estimate = this->estimate(*it);
+					if (m_budget == 0 || m_running == 0 || m_used + estimate <= m_budget)
+					{
+						const size_t task = *it;
+						m_pending.erase(it);
+						m_charged[task] = estimate;
+						m_used += estimate;
+						++m_running;
+						return task;
+					}
+				}
+
+				if (!wait)
+					return std::nullopt;
+				m_released.wait(lock);
+			}
+		}
+
+		// `task` is over, its memory is released. `observed` is the memory it actually used, if known
+		void finish(size_t task, optional<uint64_t> observed = std::nullopt) {
+			{
+				std::lock_guard lock(m_mutex);
+				this->release(task, observed);
+			}
+			m_released.notify_all();
+		}
+
+		// `task` is over but must run again, before the other pending tasks
+		void retry(size_t task) {
+			{
+				std::lock_guard lock(m_mutex);
+				this->release(task, std::nullopt);
+				m_pending.push_front(task);
+			}
+			m_released.notify_all();
+		}
+
+		// all the tasks have been handed out and are over
+		bool finished() {
+			std::lock_guard lock(m_mutex);
+			return (m_cancelled || m_pending.empty()) && m_running == 0;
+		}
+
+		// no more task is handed out
+		void cancel() {
+			{
+				std::lock_guard lock(m_mutex);
+				m_cancelled = true;
+			}
+			m_released.notify_all();
+		}
+
+	private:
+
+		struct Known
+		{
+			uint64_t sum = 0;
+			uint64_t count = 0;
+		};
+
+		uint64_t estimate(size_t task) const {
+			if (m_memory[task])
+				return *m_memory[task];
+			if (task < m_groups.size())
+				if (const Known& group = m_groupKnown[m_groups[task]]; group.count > 0)
+					return group.sum / group.count;
+			return m_known.count > 0 ? m_known.sum / m_known.count : m_budget;
+		}
+
+		// adds (or removes, with negative values) a known memory of `task` to the averages
+		void know(size_t task, int64_t memory, int64_t count) {
+			m_known.sum += memory;
+			m_known.count += count;
+			if (task < m_groups.size())
+			{
+				m_groupKnown[m_groups[task]].sum += memory;
+				m_groupKnown[m_groups[task]].count += count;
+			}
+		}
+
+		void release(size_t task, optional<uint64_t> observed) {
+			m_used -= m_charged[task];
+			m_charged[task] = 0;
+			--m_running;
+
+			if (observed)
+			{
+				if (m_memory[task])
+					this->know(task, -(int64_t)*m_memory[task], -1);
+				m_memory[task] = *observed;
+				this->know(task, (int64_t)*observed, 1);
+			}
+		}
+
+		std::mutex m_mutex;
+		std::condition_variable m_released;
+		std::deque<size_t> m_pending;
+		vector<optional<uint64_t>> m_memory;
+		vector<uint64_t> m_charged; // the estimate of the running tasks when they were handed out
+		uint64_t m_budget;
+		uint64_t m_used = 0;
+		vector<uint32_t> m_groups;
+		Known m_known;
+		vector<Known> m_groupKnown;
+		size_t m_running = 0;
+		bool m_cancelled = false;
+	};
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+
+namespace lcdoc
+{
+	using std::string;
+
+	// minimal little endian binary encoding used by the lcdoc cache and registry files
+
+	class BinaryWriter
+	{
+	public:
+
+		BinaryWriter(std::ostream& out) : m_out(out) {}
+
+		void u8(uint8_t value) {
+			m_out.put((char)value);
+		}
+
+		void u32(uint32_t value) {
+			for (int i = 0; i < 4; ++i)
+				this->u8((value >> (8 * i)) & 0xff);
+		}
+
+		void u64(uint64_t value) {
+			for (int i = 0; i < 8; ++i)
+				this->u8((value >> (8 * i)) & 0xff);
+		}
+
+		void str(const string& value) {
+			this->u32((uint32_t)value.size());
+			m_out.write(value.data(), value.size());
+		}
+
+	private:
+		std::ostream& m_out;
+	};
+
+	class BinaryReader
+	{
+	public:
+
+		BinaryReader(std::istream& in) : m_in(in) {}
+
+		uint8_t u8() {
+			const auto c = m_in.get();
+			if (c == std::istream::traits_type::eof())
+				throw std::runtime_error("unexpected end of file");
+			return (uint8_t)c;
+		}
+
+		uint32_t u32() {
+			uint32_t value = 0;
+			for (int i = 0; i < 4; ++i)
+				value |= (uint32_t)this->u8() << (8 * i);
+			return value;
+		}
+
+		uint64_t u64() {
+			uint64_t value = 0;
+			for (int i = 0; i < 8; ++i)
+				value |= (uint64_t)this->u8() << (8 * i);
+			return value;
+		}
+
+		string str() {
+			const uint32_t size = this->u32();
+			if (size > (1u << 30))
+				throw std::runtime_error("corrupted string size");
+			string value(size, '\0');
+			if (!m_in.read(value.data(), value.size()))
+				throw std::runtime_error("unexpected end of file");
+			return value;
+		}
+
+	private:
+		std::istream& m_in;
+	};
+}
@@ -0,0 +1,143 @@
+#include <stdexcept>
+#include <set>
+#include <algorithm>
+#include <cctype>
+#include <string_view>
+
+#include "Cursor.hpp"
+
+#include "CompilationDatabase.hpp"
+
+namespace lcdoc::clang
+{
+	namespace
+	{
+		// the options about the outputs of the compiler, meaningless for a parse
+		const std::set<string, std::less<>> output_flags = { "-c", "-M", "-MM", "-MD", "-MMD", "-MP" };
+		const std::set<string, std::less<>> output_flags_with_value = { "-o", "-MF", "-MT", "-MQ" };
+
+		// the same for cl.exe and clang-cl, where the options start with / or -: /c, /Fo<file>, /Fd<file>, ...
+		const std::set<string, std::less<>> cl_output_flags = { "c", "FS", "showIncludes" };
+		const vector<string> cl_output_prefixes = { "Fo", "Fd", "Fe", "Fa", "Fp", "FR", "Fr", "Yc", "Yu" };
+
+		// the options taking a path, joined (-Idir) or as the next argument (-I dir)
+		const vector<string> path_options = { "-I", "-isystem", "-iquote", "-idirafter", "-include", "-imacros", "-isysroot", "--sysroot=" };
+		const vector<string> cl_path_options = { "/I", "-I", "/FI", "-FI", "-imsvc", "/imsvc" };
+
+		// the name of the compiler of a command, lower case and without .exe: the commands may come from Windows
+		string compiler_name(const string& compiler)
+		{
+			string name = compiler.substr(compiler.find_last_of("/\\") + 1);
+			std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+			if (name.ends_with(".exe"))
+				name.resize(name.size() - 4);
+			return name;
+		}
+
+		bool is_cl_output_flag(const string& arg)
+		{
+			if (arg.size() < 2 || (arg[0] != '/' && arg[0] != '-'))
+				return false;
+			const std::string_view name = std::string_view(arg).substr(1);
+			if (cl_output_flags.contains(name))
+				return true;
+			return std::any_of(cl_output_prefixes.begin(), cl_output_prefixes.end(), [&](const string& prefix) { return name.starts_with(prefix); });
+		}
+
+		string absolute_from(const path& directory, const string& value)
+		{
+			const path p = value;
+			return p.is_relative() ? (directory / p).lexically_normal().string() : value;
+		}
+	}
+
+	CompilationDatabase::CompilationDatabase(const path& dir)
+	{
+		::CXCompilationDatabase_Error error = ::CXCompilationDatabase_NoError;
+		m_db = clang_CompilationDatabase_fromDirectory(dir.string().c_str(), &error);
+		if (error != ::CXCompilationDatabase_NoError || !m_db)
+			throw std::runtime_error("could not load the compilation database of " + dir.string());
+	}
+
+	CompilationDatabase::~CompilationDatabase()
+	{
+		if (m_db)
+			clang_CompilationDatabase_dispose(m_db);
+	}
+
+	vector<CompileCommand> CompilationDatabase::commands() const
+	{
+		vector<CompileCommand> result;
+
+		const ::CXCompileCommands commands = clang_CompilationDatabase_getAllCompileCommands(m_db);
+		if (!commands)
+			return result;
+
+		const unsigned size = clang_CompileCommands_getSize(commands);
+		result.reserve(size);
+		for (unsigned c = 0; c < size; ++c)
+		{
+			const ::CXCompileCommand command = clang_CompileCommands_getCommand(commands, c);
+			const path directory = to_string(clang_CompileCommand_getDirectory(command));
+			const path file = to_string(clang_CompileCommand_getFilename(command));
+
+			CompileCommand entry;
+			entry.file = (directory / file).lexically_normal();
+
+			const unsigned numArgs = clang_CompileCommand_getNumArgs(command);
+			vector<string> args;
+			args.reserve(numArgs);
+			for (unsigned a = 0; a < numArgs; ++a)
+				args.push_back(to_string(clang_CompileCommand_getArg(command, a)));
+
+			// the first argument is the compiler, the cl options are only understood in the cl driver mode
+			const string compiler = args.empty() ? string() : compiler_name(args.front());
+			const bool cl = compiler == "cl" || compiler == "clang-cl" || std::find(args.begin(), args.end(), "--driver-mode=cl") != args.end();
+			if (cl)
+				entry.args.push_back("--driver-mode=cl");
+			const auto& pathOptions = cl ? cl_path_options : path_options;
+
+			// the relative paths are made absolute rather than passing -working-directory, so that
+			// the commands with the same flags in different directories share their argument list
+			for (size_t a = 1; a < args.size(); ++a)
+			{
+				string arg = std::move(args[a]);
+				if (arg == "--" || arg.starts_with("--driver-mode="))
+					continue;
+				if (!arg.starts_with("-") && (directory / arg).lexically_normal() == entry.file)
+					continue;
+				if (cl && is_cl_output_flag(arg))
+					continue;
+				if (output_flags.contains(arg))
+					continue;
+				if (output_flags_with_value.contains(arg))
+				{
+					++a;
+					continue;
+				}
+				if (!cl && arg.starts_with("-o") && arg.size() > 2 && !arg.starts_with("-obj"))
+					continue;
+
+				const auto option = std::find_if(pathOptions.begin(), pathOptions.end(), [&](const string& option) { return arg.starts_with(option); });
+				if (option != pathOptions.end())
+				{
+					if (arg == *option && a + 1 < args.size())
+					{
+						entry.args.push_back(std::move(arg));
+						entry.args.push_back(absolute_from(directory, args[++a]));
+					}
+					else
+						entry.args.push_back(*option + absolute_from(directory, arg.substr(option->size())));
+					continue;
+				}
+
+				entry.args.push_back(std::move(arg));
+			}
+
+			result.push_back(std::move(entry));
+		}
+
+		clang_CompileCommands_dispose(commands);
+		return result;
+	}
+}
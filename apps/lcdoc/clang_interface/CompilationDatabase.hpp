@@ -0,0 +1,42 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <clang-c/CXCompilationDatabase.h>
+
+namespace lcdoc::clang
+{
+	using std::string;
+	using std::vector;
+	using std::filesystem::path;
+
+	struct CompileCommand
+	{
+		path file; // absolute
+		// the arguments to parse `file` with libclang: the compiler, the output options and the
+		// source file are removed, the relative paths are made absolute from the directory of the command.
+		// The commands of cl.exe and clang-cl start with --driver-mode=cl
+		vector<string> args;
+	};
+
+	// the compile_commands.json of a build directory, read by libclang
+	class CompilationDatabase
+	{
+	public:
+
+		// throws std::runtime_error if `dir` has no compile_commands.json
+		explicit CompilationDatabase(const path& dir);
+
+		CompilationDatabase(const CompilationDatabase&) = delete;
+		CompilationDatabase& operator=(const CompilationDatabase&) = delete;
+
+		~CompilationDatabase();
+
+		vector<CompileCommand> commands() const;
+
+	private:
+		::CXCompilationDatabase m_db = nullptr;
+	};
+}
@@ -6,12 +6,7 @@ namespace lcdoc::clang
 {
 	string to_string(::CXString&& str)
 	{
-		if (str.data == nullptr)
-			return {};
-
-		string result((const char*)str.data);
-		clang_disposeString(str);
-		return result;
+		return String(std::move(str)).str();
 	}
 
 	string to_string(::CXCursorKind&& kind)
@@ -53,8 +48,6 @@ namespace lcdoc::clang
 		return clang_getResultType(m_type);
 	}
 
-	CursorRef::Visitor CursorRef::m_visitor = {};
-
 	CursorRef::CursorRef():
 		m_cursor(clang_getNullCursor())
 	{
@@ -151,28 +144,9 @@ namespace lcdoc::clang
 		return clang_getCursorType(m_cursor);
 	}
 
-	void CursorRef::visitChildren(const Visitor& visitor) const
-	{
-		m_visitor = visitor;
-		{
-			// This will load all the symbols from 'IndexTest.pch'
-			clang_visitChildren(
-				m_cursor,
-				m_cursorVisitor,
-				nullptr
-			);
-		}
-		m_visitor = {};
-	}
-
 	vector<CursorRef> CursorRef::listChildren(bool recursive) const
 	{
-		vector<CursorRef> children;
-		this->visitChildren([&](const CursorRef& cursor, const ::CXCursor& parent, const ::CXClientData& client_data) {
-			children.push_back(cursor);
-			return recursive ? ::CXChildVisitResult::CXChildVisit_Recurse : ::CXChildVisitResult::CXChildVisit_Continue;
-		});
-		return children;
+		return this->children(recursive).toVector();
 	}
 
 	vector<CursorRef> CursorRef::argumnts() const
@@ -200,13 +174,4 @@ namespace lcdoc::clang
 				return false;
 		return true;
 	}
-
-	::CXChildVisitResult CursorRef::m_cursorVisitor(::CXCursor cursor, ::CXCursor parent, ::CXClientData client_data) {
-		if (m_visitor)
-		{
-			CursorRef cursorRef(cursor);
-			return m_visitor(cursorRef, parent, client_data);
-		}
-		return CXChildVisitResult::CXChildVisit_Break;
-	}
 }
\ No newline at end of file
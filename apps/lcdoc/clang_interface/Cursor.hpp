@@ -4,14 +4,20 @@
 #include <string>
 #include <functional>
 #include <vector>
+#include <memory>
+#include <type_traits>
+#include <optional>
 
 #include <clang-c/Index.h>
 
+#include "String.hpp"
+
 namespace lcdoc::clang
 {
 	using std::string;
 	using std::function;
 	using std::vector;
+	using std::optional;
 	using std::filesystem::path;
 
 	string to_string(::CXString&& str);
@@ -76,27 +82,74 @@ namespace lcdoc::clang
 	{
 	public:
 
-		using Visitor = function<::CXChildVisitResult(const CursorRef& cursor, const ::CXCursor& parent, const ::CXClientData& client_data)>;
+		using Visitor = function<::CXChildVisitResult(const CursorRef& cursor, const CursorRef& parent)>;
 
-		struct Location {
+		class ChildRange;
 
-			Location(::CXSourceLocation loc) : m_loc(loc) {
-				::CXFile file;
-				clang_getSpellingLocation(m_loc, &file, &line, &column, &offset);
-				fileName = to_string(clang_getFileName(file));
-			}
+		// A source location resolved on demand: isFromMainFile() needs no resolution, the line, column
+		// and offset are resolved by the first of them read, the file name only when it is read.
+		// Not thread safe, a Location is meant to be a local value.
+		class Location
+		{
+		public:
 
-			path fileName;
-			unsigned line = 0;
-			unsigned column = 0;
-			unsigned offset = 0;
+			Location(::CXSourceLocation loc) : m_loc(loc) {}
+
+			// a copy keeps the resolved position, the file name is read again if needed
+			Location(const Location& other) : m_loc(other.m_loc), m_position(other.m_position) {}
+			Location(Location&&) = default;
+			Location& operator=(const Location& other) {
+				m_loc = other.m_loc;
+				m_position = other.m_position;
+				m_file.reset();
+				return *this;
+			}
+			Location& operator=(Location&&) = default;
 
 			bool isFromMainFile() const {
 				return clang_Location_isFromMainFile(m_loc);
 			}
 
+			// the file name as reported by clang, read in place
+			const String& file() const {
+				if (!m_file)
+					m_file.emplace(clang_getFileName(this->position().file));
+				return *m_file;
+			}
+
+			path fileName() const { return path(this->file().view()); }
+
+			unsigned line() const { return this->position().line; }
+			unsigned column() const { return this->position().column; }
+			unsigned offset() const { return this->position().offset; }
+
+			// the file of the location, nullptr if none (e.g. a builtin)
+			::CXFile fileHandle() const { return this->position().file; }
+
+			::CXSourceLocation handle() const { return m_loc; }
+
 		private:
+
+			struct Position
+			{
+				::CXFile file = nullptr;
+				unsigned line = 0;
+				unsigned column = 0;
+				unsigned offset = 0;
+			};
+
+			const Position& position() const {
+				if (!m_position)
+				{
+					Position& position = m_position.emplace();
+					clang_getSpellingLocation(m_loc, &position.file, &position.line, &position.column, &position.offset);
+				}
+				return *m_position;
+			}
+
 			::CXSourceLocation m_loc;
+			mutable optional<Position> m_position;
+			mutable optional<String> m_file;
 		};
 
 		CursorRef();
@@ -115,6 +168,11 @@ namespace lcdoc::clang
 		bool operator==(const CursorRef& other) const;
 		bool operator==(const ::CXCursor& other) const;
 
+		// consistent with operator==
+		size_t hash() const {
+			return clang_hashCursor(m_cursor);
+		}
+
 		CursorRef canonical() const;
 
 		string spelling() const;
@@ -133,13 +191,31 @@ namespace lcdoc::clang
 
 		string rawCommentText() const;
 
+		// the range of the doc comment, null if none: cheaper than the text, nothing is copied nor parsed
+		::CXSourceRange commentRange() const {
+			return clang_Cursor_getCommentRange(m_cursor);
+		}
+
 		string mangled_name() const;
 
 		TypeRef type() const;
 
 		string tmp() const;
 
-		void visitChildren(const Visitor& visitor) const;
+		// Visits the children with any callable `(const CursorRef& cursor, const CursorRef& parent) -> CXChildVisitResult`.
+		// The callable is passed to libclang as client data, so traversals can be nested and run concurrently.
+		template <class F>
+		void visitChildren(F&& visitor) const {
+			using V = std::remove_reference_t<F>;
+			clang_visitChildren(
+				m_cursor,
+				&m_cursorVisitor<V>,
+				const_cast<void*>(static_cast<const void*>(std::addressof(visitor)))
+			);
+		}
+
+		// lazy range over the children, nothing is stored, see ChildRange
+		ChildRange children(bool recursive = false) const;
 
 		vector<CursorRef> listChildren(bool recursive = false) const;
 
@@ -173,9 +249,24 @@ namespace lcdoc::clang
 			return to_string(clang_getCursorDisplayName(m_cursor));
 		}
 
+		// Unified Symbol Resolution: the same for every declaration of an entity, in every translation unit
+		string usr() const {
+			return to_string(clang_getCursorUSR(m_cursor));
+		}
+
+		// usr() without the copy, e.g. for a lookup
+		String usrString() const {
+			return String(clang_getCursorUSR(m_cursor));
+		}
+
 		::CXCursor& handle() { return m_cursor; }
 		const ::CXCursor& handle() const { return m_cursor; }
 
+		// the access of a class member, CX_CXXInvalidAccessSpecifier for the other cursors
+		::CX_CXXAccessSpecifier access() const {
+			return clang_getCXXAccessSpecifier(m_cursor);
+		}
+
 		bool isEnumDeclScoped() const {
 			return clang_EnumDecl_isScoped(m_cursor);
 		}
@@ -191,7 +282,50 @@ namespace lcdoc::clang
 	private:
 		::CXCursor m_cursor;
 
-		static Visitor m_visitor;
-		static ::CXChildVisitResult m_cursorVisitor(::CXCursor cursor, ::CXCursor parent, ::CXClientData client_data);
+		template <class V>
+		static ::CXChildVisitResult m_cursorVisitor(::CXCursor cursor, ::CXCursor parent, ::CXClientData client_data) {
+			V& visitor = *static_cast<V*>(client_data);
+			return visitor(CursorRef(cursor), CursorRef(parent));
+		}
 	};
+
+	// Children of a cursor, streamed directly from clang_visitChildren.
+	// libclang only offers a push traversal, so the range is consumed with forEach:
+	// the callable receives each child as soon as libclang reaches it and can stop the traversal
+	// by returning false (a void callable visits everything).
+	class CursorRef::ChildRange
+	{
+	public:
+
+		ChildRange(const CursorRef& parent, bool recursive) : m_parent(parent), m_recursive(recursive) {}
+
+		template <class F>
+		void forEach(F&& f) const {
+			const auto next = m_recursive ? ::CXChildVisit_Recurse : ::CXChildVisit_Continue;
+			m_parent.visitChildren([&](const CursorRef& cursor, const CursorRef&) -> ::CXChildVisitResult {
+				if constexpr (std::is_void_v<std::invoke_result_t<F&, const CursorRef&>>)
+				{
+					f(cursor);
+					return next;
+				}
+				else
+					return f(cursor) ? next : ::CXChildVisit_Break;
+			});
+		}
+
+		vector<CursorRef> toVector() const {
+			vector<CursorRef> children;
+			this->forEach([&](const CursorRef& cursor) { children.push_back(cursor); });
+			return children;
+		}
+
+	private:
+		CursorRef m_parent;
+		bool m_recursive = false;
+	};
+
+	inline CursorRef::ChildRange CursorRef::children(bool recursive) const
+	{
+		return ChildRange(*this, recursive);
+	}
 }
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <clang-c/Index.h>
+
+#include "Index.hpp"
+
+namespace lcdoc::clang
+{
+	// A session of clang_indexSourceFile, shared by the units indexed one after another so that
+	// the bodies of the headers already parsed in the session are skipped (CXIndexOpt_SkipParsedBodiesInSession)
+	class IndexAction
+	{
+	public:
+
+		explicit IndexAction(const Index& idx) {
+			m_action = clang_IndexAction_create(idx.handle());
+		}
+
+		IndexAction(const IndexAction&) = delete;
+		IndexAction& operator=(const IndexAction&) = delete;
+
+		~IndexAction() {
+			clang_IndexAction_dispose(m_action);
+		}
+
+		::CXIndexAction handle() const {
+			return m_action;
+		}
+
+	private:
+		::CXIndexAction m_action = nullptr;
+	};
+}
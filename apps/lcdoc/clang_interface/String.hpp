@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <functional>
+
+#include <clang-c/Index.h>
+
+namespace lcdoc::clang
+{
+	using std::string;
+	using std::string_view;
+
+	// Owns a CXString and reads it in place: comparing and hashing do not copy the characters,
+	// only str() does. Move only, the string is disposed with the object.
+	class String
+	{
+	public:
+
+		String() = default;
+
+		explicit String(::CXString&& str) : m_str(str) {
+			str.data = nullptr;
+		}
+
+		String(String&& other) noexcept : m_str(other.m_str) {
+			other.m_str.data = nullptr;
+		}
+
+		String& operator=(String&& other) noexcept {
+			if (this != &other)
+			{
+				this->dispose();
+				m_str = other.m_str;
+				other.m_str.data = nullptr;
+			}
+			return *this;
+		}
+
+		String(const String&) = delete;
+		String& operator=(const String&) = delete;
+
+		~String() {
+			this->dispose();
+		}
+
+		string_view view() const {
+			const char* chars = m_str.data ? clang_getCString(m_str) : nullptr;
+			return chars ? string_view(chars) : string_view();
+		}
+
+		operator string_view() const { return this->view(); }
+
+		string str() const { return string(this->view()); }
+
+		bool empty() const { return this->view().empty(); }
+
+		bool operator==(const String& other) const { return this->view() == other.view(); }
+		bool operator==(string_view other) const { return this->view() == other; }
+
+		// consistent with operator==, and with std::hash<string_view> of the same characters
+		size_t hash() const {
+			return std::hash<string_view>()(this->view());
+		}
+
+	private:
+
+		void dispose() {
+			if (m_str.data)
+				clang_disposeString(m_str);
+			m_str.data = nullptr;
+		}
+
+		::CXString m_str{ nullptr, 0 };
+	};
+}
@@ -3,37 +3,120 @@
 
 namespace lcdoc::clang
 {
-	TranslationUnit::TranslationUnit(const Index& idx, const path& srcFile, const vector<string>& clang_args)
+	TranslationUnit::TranslationUnit(const Index& idx, const path& srcFile, const vector<string>& clang_args, unsigned options)
 	{
 		vector<const char*> cargs;
 		for (const auto& arg : clang_args)
 			cargs.push_back(arg.c_str());
 
-		// example:
-		// // This will load all the symbols from 'IndexTest.c', excluding symbols
-		// // from 'IndexTest.pch'.
-		// char* args[] = { "-Xclang", "-include-pch=IndexTest.pch" };
-		// TU = clang_createTranslationUnitFromSourceFile(Idx, "IndexTest.c", 2, args,
-		// 	0, 0);
-		// clang_visitChildren(clang_getTranslationUnitCursor(TU),
-		// 	TranslationUnitVisitor, 0);
-		// clang_disposeTranslationUnit(TU);
-
-		m_TU = clang_createTranslationUnitFromSourceFile(
+		m_error = clang_parseTranslationUnit2(
 			idx.handle(),               // index
 			srcFile.string().c_str(),   // file
-			cargs.size(), cargs.data(), // command line clang args
-			0, nullptr                  // unsave files
+			cargs.data(), (int)cargs.size(), // command line clang args
+			nullptr, 0,                 // unsaved files
+			options,                    // CXTranslationUnit_Flags
+			&m_TU
 		);
+
+		if (m_error != ::CXError_Success)
+			m_TU = nullptr;
 	}
 
 	TranslationUnit::~TranslationUnit()
 	{
-		clang_disposeTranslationUnit(m_TU);
+		this->dispose();
+	}
+
+	void TranslationUnit::dispose()
+	{
+		if (m_TU)
+			clang_disposeTranslationUnit(m_TU);
+		m_TU = nullptr;
+	}
+
+	bool TranslationUnit::reparse()
+	{
+		if (!m_TU)
+			return false;
+
+		const int error = clang_reparseTranslationUnit(m_TU, 0, nullptr, clang_defaultReparseOptions(m_TU));
+		if (error != 0)
+		{
+			m_error = (::CXErrorCode)error;
+			// the unit is no longer valid
+			clang_disposeTranslationUnit(m_TU);
+			m_TU = nullptr;
+			return false;
+		}
+
+		return true;
 	}
 
 	CursorRef TranslationUnit::cursor()
 	{
 		return clang_getTranslationUnitCursor(m_TU);
 	}
-}
\ No newline at end of file
+
+	bool TranslationUnit::save(const path& file) const
+	{
+		if (!m_TU)
+			return false;
+
+		return clang_saveTranslationUnit(m_TU, file.string().c_str(), clang_defaultSaveOptions(m_TU)) == ::CXSaveError_None;
+	}
+
+	vector<path> TranslationUnit::inclusions() const
+	{
+		vector<path> files;
+		if (!m_TU)
+			return files;
+
+		clang_getInclusions(
+			m_TU,
+			[](::CXFile file, ::CXSourceLocation*, unsigned depth, ::CXClientData client_data) {
+				if (depth > 0)
+					static_cast<vector<path>*>(client_data)->push_back(to_string(clang_getFileName(file)));
+			},
+			&files
+		);
+		return files;
+	}
+
+	vector<Inclusion> TranslationUnit::includeGraph() const
+	{
+		vector<Inclusion> edges;
+		if (!m_TU)
+			return edges;
+
+		clang_getInclusions(
+			m_TU,
+			[](::CXFile file, ::CXSourceLocation* stack, unsigned depth, ::CXClientData client_data) {
+				if (depth == 0)
+					return;
+
+				// the top of the stack is the #include directive, in the includer
+				::CXFile includer = nullptr;
+				clang_getFileLocation(stack[0], &includer, nullptr, nullptr, nullptr);
+				if (!includer)
+					return;
+
+				static_cast<vector<Inclusion>*>(client_data)->push_back({ to_string(clang_getFileName(includer)), to_string(clang_getFileName(file)) });
+			},
+			&edges
+		);
+		return edges;
+	}
+
+	uint64_t TranslationUnit::memoryUsage() const
+	{
+		if (!m_TU)
+			return 0;
+
+		const ::CXTUResourceUsage usage = clang_getCXTUResourceUsage(m_TU);
+		uint64_t bytes = 0;
+		for (unsigned i = 0; i < usage.numEntries; ++i)
+			bytes += usage.entries[i].amount;
+		clang_disposeCXTUResourceUsage(usage);
+		return bytes;
+	}
+}
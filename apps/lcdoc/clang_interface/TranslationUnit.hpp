@@ -12,6 +12,13 @@ namespace lcdoc::clang
 	using std::filesystem::path;
 	using std::vector;
 
+	// an #include directive resolved by clang
+	struct Inclusion
+	{
+		path includer;
+		path included;
+	};
+
 	class TranslationUnit
 	{
 	public:
@@ -22,13 +29,45 @@ namespace lcdoc::clang
 		// 	m_TU = clang_createTranslationUnit(idx, "IndexTest.pch");
 		// }
 
-		TranslationUnit(const Index& idx, const path& srcFile, const vector<string>& clang_args);
+		// `options` are CXTranslationUnit_Flags
+		TranslationUnit(const Index& idx, const path& srcFile, const vector<string>& clang_args, unsigned options = ::CXTranslationUnit_DetailedPreprocessingRecord);
+
+		// takes the ownership of a unit produced elsewhere, e.g. by clang_indexSourceFile
+		explicit TranslationUnit(::CXTranslationUnit TU, ::CXErrorCode error = ::CXError_Success) : m_TU(TU), m_error(error) {}
+
+		TranslationUnit(const TranslationUnit&) = delete;
+		TranslationUnit& operator=(const TranslationUnit&) = delete;
 
 		~TranslationUnit();
 
+		// releases the AST now rather than at the end of the scope, the unit is then invalid
+		void dispose();
+
+		// Reparses the translation unit from the files on disk, much faster than a new parse
+		// as clang reuses what did not change. On failure the unit is disposed and false is returned.
+		bool reparse();
+
+		explicit operator bool() const { return m_TU != nullptr; }
+
+		// the result of the parse, CXError_Success if the unit is valid
+		::CXErrorCode error() const { return m_error; }
+
 		CursorRef cursor();
 
+		// saves the unit to `file`, parsing a header with -x c++-header produces a PCH usable with -include-pch
+		bool save(const path& file) const;
+
+		// all the files included (directly or not) by the translation unit, the main file excluded
+		vector<path> inclusions() const;
+
+		// the #include edges of the translation unit, starting from the main file
+		vector<Inclusion> includeGraph() const;
+
+		// bytes of memory used by the unit, as reported by clang_getCXTUResourceUsage
+		uint64_t memoryUsage() const;
+
 	private:
 		::CXTranslationUnit m_TU = nullptr;
+		::CXErrorCode m_error = ::CXError_Success;
 	};
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 // !!!
 #include <iostream>
 #include <cassert>
+#include <unordered_map>
 
 #include "clang_interface/TranslationUnit.hpp"
 
@@ -23,19 +24,46 @@ namespace
 				throw std::runtime_error(message);
 		}
 
-		shared_ptr<CXXType> make_type(const clang::TypeRef& ctype, SymbolRegistry& registry);
-		shared_ptr<CXXType> to_type(const clang::TypeRef& ctype, SymbolRegistry& registry);
+		struct CursorHash
+		{
+			size_t operator()(const CursorRef& cursor) const { return cursor.hash(); }
+		};
+
+		// state of the extraction of the symbols of one translation unit
+		struct Extraction
+		{
+			SymbolRegistry& registry;
+
+			// the symbols already recorded from the cursors of the translation unit:
+			// a parent is resolved once and then reused by all its children
+			std::unordered_map<CursorRef, shared_ptr<Symbol>, CursorHash> recorded = {};
+		};
+
+		shared_ptr<CXXType> make_type(const clang::TypeRef& ctype, Extraction& ex);
+		shared_ptr<CXXType> to_type(const clang::TypeRef& ctype, Extraction& ex);
 
 		Location to_location(const CursorRef::Location& loc)
 		{
 			Location result;
-			result.fileName = loc.fileName;
-			result.line = loc.line;
-			result.column = loc.column;
-			result.offset = loc.offset;
+			result.file = loc.file().str();
+			result.line = loc.line();
+			result.column = loc.column();
+			result.offset = loc.offset();
 			return result;
 		}
 
+		// only the range is kept, the comment is read and parsed if the symbol is rendered
+		CommentRange to_comment_range(const CursorRef& cursor)
+		{
+			const ::CXSourceRange range = cursor.commentRange();
+			if (clang_Range_isNull(range))
+				return {};
+
+			const CursorRef::Location begin = clang_getRangeStart(range);
+			const CursorRef::Location end = clang_getRangeEnd(range);
+			return { InternedString(begin.file().view()), begin.offset(), end.offset() };
+		}
+
 		SymbolIdPart build_idPart(const CursorRef& cursor)
 		{
 			if (!cursor)
@@ -47,32 +75,29 @@ namespace
 				::CXCursorKind::CXCursor_Namespace,
 				::CXCursorKind::CXCursor_StructDecl,
 				::CXCursorKind::CXCursor_ClassDecl,
+				::CXCursorKind::CXCursor_EnumDecl,
+				::CXCursorKind::CXCursor_TypedefDecl,
 				// TOOD templates
 				// ...
 			};
 			if (plain_name.find(cursor.kind()) != plain_name.end())
 				return { cursor.spelling(), cursor.spelling(), cursor.displayName() };
 
-			std::cerr << to_string(cursor.kind()) << std::endl;
-			//assert(("not handled", false));
-
+			// unexposed declarations and linkage specifications have no name
 			return {};
 		}
 
-		SymbolId build_id(const CursorRef& cursor)
+		string usr_of(const CursorRef& cursor)
 		{
 			if (!cursor)
 				return {};
 
-			const SymbolIdPart this_id = build_idPart(cursor);
-
-			if (this_id.empty())
-				return {};
-
-			if (cursor.isTopLevel())
-				return { this_id };
+			if (auto usr = cursor.usr(); !usr.empty())
+				return usr;
 
-			return build_id(cursor.semanticParent()) + this_id;
+			// declarations without a USR (e.g. linkage specifications) get a synthetic one, built from their parent
+			const string parent = cursor.isTopLevel() ? string() : usr_of(cursor.semanticParent());
+			return parent + "$" + to_string(cursor.kind()) + "$" + cursor.spelling();
 		}
 
 		shared_ptr<Symbol> find(const CursorRef& cursor, const SymbolRegistry& registry)
@@ -80,45 +105,51 @@ namespace
 			if (!cursor)
 				return nullptr;
 
-			auto id = build_id(cursor);
+			// most cursors have a USR, looked up in place
+			if (const auto usr = cursor.usrString(); !usr.empty())
+				return registry.find(usr.view());
 
-			auto sym = registry.findFromId(id);
-
-			return sym;
+			return registry.find(usr_of(cursor));
 		}
 
-		shared_ptr<UnexposedDeclarationSymbol> handleUnexposedDecl(const CursorRef& cursor, SymbolRegistry& registry);
-		shared_ptr<NamespaceSymbol> handleNamespaceDecl(const CursorRef& cursor, SymbolRegistry& registry);
-		shared_ptr<FunctionSymbol> handleFunctionDecl(const CursorRef& cursor, SymbolRegistry& registry);
-		shared_ptr<ClassSymbol> handleClassDecl(const CursorRef& cursor, SymbolRegistry& registry);
-		shared_ptr<EnumSymbol> handleEnumDecl(const CursorRef& cursor, SymbolRegistry& registry);
-		shared_ptr<TypedefSymbol> handleTypedefDecl(const CursorRef& cursor, SymbolRegistry& registry);
+		shared_ptr<UnexposedDeclarationSymbol> handleUnexposedDecl(const CursorRef& cursor, Extraction& ex);
+		shared_ptr<NamespaceSymbol> handleNamespaceDecl(const CursorRef& cursor, Extraction& ex);
+		shared_ptr<FunctionSymbol> handleFunctionDecl(const CursorRef& cursor, Extraction& ex);
+		shared_ptr<ClassSymbol> handleClassDecl(const CursorRef& cursor, Extraction& ex);
+		shared_ptr<EnumSymbol> handleEnumDecl(const CursorRef& cursor, Extraction& ex);
+		shared_ptr<TypedefSymbol> handleTypedefDecl(const CursorRef& cursor, Extraction& ex);
 
-		shared_ptr<Symbol> record(const CursorRef& cursor, SymbolRegistry& registry)
+		shared_ptr<Symbol> record(const CursorRef& cursor, Extraction& ex)
 		{
-			auto sym = find(cursor, registry);
+			if (auto it = ex.recorded.find(cursor); it != ex.recorded.end())
+				return it->second;
+
+			auto sym = find(cursor, ex.registry);
 			if (sym)
+			{
+				ex.recorded.emplace(cursor, sym);
 				return sym;
+			}
 
 			switch (cursor.kind())
 			{
 			case ::CXCursor_UnexposedDecl:
-				sym = handleUnexposedDecl(cursor, registry);
+				sym = handleUnexposedDecl(cursor, ex);
 				break;
 			case ::CXCursorKind::CXCursor_FunctionDecl:
-				sym = handleFunctionDecl(cursor, registry);
+				sym = handleFunctionDecl(cursor, ex);
 				break;
 			case ::CXCursorKind::CXCursor_Namespace:
-				sym = handleNamespaceDecl(cursor, registry);
+				sym = handleNamespaceDecl(cursor, ex);
 				break;
 			case ::CXCursorKind::CXCursor_ClassDecl:
-				sym = handleClassDecl(cursor, registry);
+				sym = handleClassDecl(cursor, ex);
 				break;
 			case ::CXCursorKind::CXCursor_EnumDecl:
-				sym = handleEnumDecl(cursor, registry);
+				sym = handleEnumDecl(cursor, ex);
 				break;
 			case ::CXCursorKind::CXCursor_TypedefDecl:
-				sym = handleTypedefDecl(cursor, registry);
+				sym = handleTypedefDecl(cursor, ex);
 				break;
 			default:
 				//assert(0);
@@ -128,13 +159,17 @@ namespace
 			//assert((bool)sym);
 			if (sym)
 			{
+				// resolved once, whatever the number of uses below
 				const auto cursorLocation = cursor.location();
 				if (cursorLocation.isFromMainFile())
 					sym->exposed = true;
 
 				// ? necessary?
 				if (sym->exposed)
-					sym->declarations.insert(to_location(cursor.definition().location()));
+				{
+					const auto definition = cursor.definition();
+					sym->declarations.insert(to_location(definition == cursor ? cursorLocation : definition.location()));
+				}
 
 				if (cursor.isDeclaration())
 					sym->declarations.insert(to_location(cursorLocation));
@@ -143,42 +178,35 @@ namespace
 					sym->definitions.insert(to_location(cursorLocation));
 
 				if (cursor.isDefinition() || cursor.isDeclaration())
-				{
-					const string brief = cursor.briefCommentText();
-					const string raw = cursor.rawCommentText();
+					sym->docStr.merge(DocumentationString(to_comment_range(cursor)));
 
-					if (!brief.empty())
-						sym->docStr.brief = brief;
-
-					if (!raw.empty() && raw.length() > sym->docStr.raw.length())
-						sym->docStr.raw = raw;
-				}
-
-				registry.add(sym);
+				ex.registry.add(sym);
 			}
 
+			ex.recorded.emplace(cursor, sym);
 			return sym;
 		}
 
-		void setParent(const shared_ptr<Symbol> symbol, const CursorRef& cursor, SymbolRegistry& registry)
+		void setParent(const shared_ptr<Symbol> symbol, const CursorRef& cursor, Extraction& ex)
 		{
 			if (cursor.isTopLevel())
 				// nothing to do
 				return;
 
-			auto parent = record(cursor.semanticParent(), registry);
+			auto parent = record(cursor.semanticParent(), ex);
 			throwAssert((bool)parent);
-			symbol->parent = parent;
+			// the parent is recorded, hence added to the registry, before its children
+			symbol->parentIndex = parent->index();
 		}
 
-		shared_ptr<UnexposedDeclarationSymbol> handleUnexposedDecl(const CursorRef& cursor, SymbolRegistry& registry)
+		shared_ptr<UnexposedDeclarationSymbol> handleUnexposedDecl(const CursorRef& cursor, Extraction& ex)
 		{
 			if (cursor.kind() != ::CXCursorKind::CXCursor_UnexposedDecl)
 				return nullptr;
 
 			const auto part = build_idPart(cursor);
-			auto UD = make_shared<UnexposedDeclarationSymbol>(part);
-			setParent(UD, cursor, registry);
+			auto UD = ex.registry.make<UnexposedDeclarationSymbol>(part, usr_of(cursor));
+			setParent(UD, cursor, ex);
 
 			UD->spelling = cursor.spelling();
 			UD->displayName = cursor.displayName();
@@ -186,14 +214,14 @@ namespace
 			return UD;
 		}
 
-		shared_ptr<NamespaceSymbol> handleNamespaceDecl(const CursorRef& cursor, SymbolRegistry& registry)
+		shared_ptr<NamespaceSymbol> handleNamespaceDecl(const CursorRef& cursor, Extraction& ex)
 		{
 			if (cursor.kind() != ::CXCursorKind::CXCursor_Namespace)
 				return nullptr;
 
 			const auto part = build_idPart(cursor);
-			auto N = make_shared<NamespaceSymbol>(part);
-			setParent(N, cursor, registry);
+			auto N = ex.registry.make<NamespaceSymbol>(part, usr_of(cursor));
+			setParent(N, cursor, ex);
 
 			N->spelling = cursor.spelling();
 			N->displayName = cursor.displayName();
@@ -201,14 +229,14 @@ namespace
 			return N;
 		}
 
-		shared_ptr<FunctionSymbol> handleFunctionDecl(const CursorRef& cursor, SymbolRegistry& registry)
+		shared_ptr<FunctionSymbol> handleFunctionDecl(const CursorRef& cursor, Extraction& ex)
 		{
 			if (cursor.kind() != ::CXCursorKind::CXCursor_FunctionDecl)
 				return nullptr;
 
 			const auto part = build_idPart(cursor);
-			auto f = make_shared<FunctionSymbol>(part);
-			setParent(f, cursor, registry);
+			auto f = ex.registry.make<FunctionSymbol>(part, usr_of(cursor));
+			setParent(f, cursor, ex);
 
 			f->spelling = cursor.spelling();
 			f->displayName = cursor.displayName();
@@ -217,12 +245,12 @@ namespace
 			if (!f->signature)
 			{
 				f->signature = make_unique<FunctionSignature>();
-				f->signature->ret = to_type(cursor.resultType(), registry);
+				f->signature->ret = to_type(cursor.resultType(), ex);
 				for (const auto& a : cursor.argumnts())
 				{
 					FuncArg arg;
 					arg.name = a.spelling();
-					arg.type = to_type(a.type(), registry);
+					arg.type = to_type(a.type(), ex);
 					f->signature->args.push_back(std::move(arg));
 				}
 			}
@@ -230,14 +258,14 @@ namespace
 			return f;
 		}
 
-		shared_ptr<ClassSymbol> handleClassDecl(const CursorRef& cursor, SymbolRegistry& registry)
+		shared_ptr<ClassSymbol> handleClassDecl(const CursorRef& cursor, Extraction& ex)
 		{
 			if (cursor.kind() != ::CXCursorKind::CXCursor_ClassDecl)
 				return nullptr;
 
 			const auto part = build_idPart(cursor);
-			auto c = make_shared<ClassSymbol>(part);
-			setParent(c, cursor, registry);
+			auto c = ex.registry.make<ClassSymbol>(part, usr_of(cursor));
+			setParent(c, cursor, ex);
 
 			c->spelling = cursor.spelling();
 			c->displayName = cursor.displayName();
@@ -245,14 +273,14 @@ namespace
 			return c;
 		}
 
-		shared_ptr<EnumSymbol> handleEnumDecl(const CursorRef& cursor, SymbolRegistry& registry)
+		shared_ptr<EnumSymbol> handleEnumDecl(const CursorRef& cursor, Extraction& ex)
 		{
 			if (cursor.kind() != ::CXCursorKind::CXCursor_EnumDecl)
 				return nullptr;
 
 			const auto part = build_idPart(cursor);
-			auto e = make_shared<EnumSymbol>(part);
-			setParent(e, cursor, registry);
+			auto e = ex.registry.make<EnumSymbol>(part, usr_of(cursor));
+			setParent(e, cursor, ex);
 
 			e->spelling = cursor.spelling();
 			e->displayName = cursor.displayName();
@@ -262,24 +290,24 @@ namespace
 			return e;
 		}
 
-		shared_ptr<TypedefSymbol> handleTypedefDecl(const CursorRef& cursor, SymbolRegistry& registry)
+		shared_ptr<TypedefSymbol> handleTypedefDecl(const CursorRef& cursor, Extraction& ex)
 		{
 			if (cursor.kind() != ::CXCursorKind::CXCursor_TypedefDecl)
 				return nullptr;
 
 			const auto part = build_idPart(cursor);
-			auto tdef = make_shared<TypedefSymbol>(part);
-			setParent(tdef, cursor, registry);
+			auto tdef = ex.registry.make<TypedefSymbol>(part, usr_of(cursor));
+			setParent(tdef, cursor, ex);
 
 			tdef->spelling = cursor.spelling();
 			tdef->displayName = cursor.displayName();
 
-			tdef->underlying = to_type(cursor.typedefUnderlyingType(), registry);
+			tdef->underlying = to_type(cursor.typedefUnderlyingType(), ex);
 
 			return tdef;
 		}
 
-		shared_ptr<CXXType> make_type(const clang::TypeRef& ctype, SymbolRegistry& registry)
+		shared_ptr<CXXType> make_type(const clang::TypeRef& ctype, Extraction& ex)
 		{
 			shared_ptr<CXXType> result;
 			switch (ctype.kind())
@@ -291,7 +319,7 @@ namespace
 			case ::CXTypeKind::CXType_Elaborated:
 			{
 				auto elaborated = make_shared<ElaboratedType>();
-				auto named = to_type(ctype.named(), registry);
+				auto named = to_type(ctype.named(), ex);
 				elaborated->named = named;
 				result = elaborated;
 				break;
@@ -299,177 +327,50 @@ namespace
 			case CXType_Record:
 			{
 				auto rec = make_shared<RecordType>();
-				rec->recorded = record(ctype.declaration(), registry); // canonical?
+				rec->recorded = record(ctype.declaration(), ex); // canonical?
 				result = rec;
 				break;
 			}
 			case ::CXTypeKind::CXType_Pointer:
 			{
 				auto p = make_shared<PointerType>();
-				p->pointee = to_type(ctype.pointee(), registry);
+				p->pointee = to_type(ctype.pointee(), ex);
 				result = p;
 				break;
 			}
 			case ::CXTypeKind::CXType_LValueReference:
 			{
 				auto r = make_shared<LValueReferenceType>();
-				r->pointee = to_type(ctype.pointee(), registry);
+				r->pointee = to_type(ctype.pointee(), ex);
 				result = r;
 				break;
 			}
 			case ::CXTypeKind::CXType_RValueReference:
 			{
 				auto r = make_shared<RValueReferenceType>();
-				r->pointee = to_type(ctype.pointee(), registry);
+				r->pointee = to_type(ctype.pointee(), ex);
 				result = r;
 				break;
 			}
 			case ::CXTypeKind::CXType_Enum:
 			{
 				auto e = make_shared<EnumType>();
-				e->enumSymbol = std::dynamic_pointer_cast<EnumSymbol>(record(ctype.declaration(), registry));
+				e->enumSymbol = std::dynamic_pointer_cast<EnumSymbol>(record(ctype.declaration(), ex));
 				result = e;
 				break;
 			}
 			case ::CXTypeKind::CXType_Typedef:
 			{
 				auto tdef = make_shared<TypedefType>();
-				tdef->symbol = std::dynamic_pointer_cast<TypedefSymbol>(record(ctype.declaration(), registry));
+				tdef->symbol = std::dynamic_pointer_cast<TypedefSymbol>(record(ctype.declaration(), ex));
 				tdef->typedefName = ctype.typedefName();
 				result = tdef;
 				break;
 			}
 
-#define lc_tmp_basic_case(cx_type) case cx_type: result = make_shared<basic_types::get_basic_type<cx_type>::type>(); break;
-
-			// BEGIN Basic Types
-#if true
-			lc_tmp_basic_case(::CXTypeKind::CXType_Void);
-			lc_tmp_basic_case(::CXTypeKind::CXType_Bool);
-			lc_tmp_basic_case(::CXTypeKind::CXType_Char_U);
-			lc_tmp_basic_case(::CXTypeKind::CXType_UChar);
-			lc_tmp_basic_case(::CXTypeKind::CXType_Char16);
-			lc_tmp_basic_case(::CXTypeKind::CXType_Char32);
-			lc_tmp_basic_case(::CXTypeKind::CXType_UShort);
-			lc_tmp_basic_case(::CXTypeKind::CXType_UInt);
-			lc_tmp_basic_case(::CXTypeKind::CXType_ULong);
-			lc_tmp_basic_case(::CXTypeKind::CXType_ULongLong);
-			lc_tmp_basic_case(::CXTypeKind::CXType_UInt128);
-			lc_tmp_basic_case(::CXTypeKind::CXType_Char_S);
-			lc_tmp_basic_case(::CXTypeKind::CXType_SChar);
-			lc_tmp_basic_case(::CXTypeKind::CXType_WChar);
-			lc_tmp_basic_case(::CXTypeKind::CXType_Short);
-			lc_tmp_basic_case(::CXTypeKind::CXType_Int);
-			lc_tmp_basic_case(::CXTypeKind::CXType_Long);
-			lc_tmp_basic_case(::CXTypeKind::CXType_LongLong);
-			lc_tmp_basic_case(::CXTypeKind::CXType_Int128);
-			lc_tmp_basic_case(::CXTypeKind::CXType_Float);
-			lc_tmp_basic_case(::CXTypeKind::CXType_Double);
-			lc_tmp_basic_case(::CXTypeKind::CXType_LongDouble);
-			lc_tmp_basic_case(::CXTypeKind::CXType_NullPtr);
-			lc_tmp_basic_case(::CXTypeKind::CXType_Overload);
-			lc_tmp_basic_case(::CXTypeKind::CXType_Dependent);
-			lc_tmp_basic_case(::CXTypeKind::CXType_ObjCId);
-			lc_tmp_basic_case(::CXTypeKind::CXType_ObjCClass);
-			lc_tmp_basic_case(::CXTypeKind::CXType_ObjCSel);
-			lc_tmp_basic_case(::CXTypeKind::CXType_Float128);
-			lc_tmp_basic_case(::CXTypeKind::CXType_Half);
-			lc_tmp_basic_case(::CXTypeKind::CXType_Float16);
-			lc_tmp_basic_case(::CXTypeKind::CXType_ShortAccum);
-			lc_tmp_basic_case(::CXTypeKind::CXType_Accum);
-			lc_tmp_basic_case(::CXTypeKind::CXType_LongAccum);
-			lc_tmp_basic_case(::CXTypeKind::CXType_UShortAccum);
-			lc_tmp_basic_case(::CXTypeKind::CXType_UAccum);
-			lc_tmp_basic_case(::CXTypeKind::CXType_ULongAccum);
-			lc_tmp_basic_case(::CXTypeKind::CXType_BFloat16);
-			lc_tmp_basic_case(::CXTypeKind::CXType_Ibm128);
-			//lc_tmp_basic_case(::CXTypeKind::CXType_FirstBuiltin);
-			//lc_tmp_basic_case(::CXTypeKind::CXType_LastBuiltin);
-			lc_tmp_basic_case(::CXTypeKind::CXType_Complex);
-			//lc_tmp_basic_case(::CXTypeKind::CXType_Pointer);
-			lc_tmp_basic_case(::CXTypeKind::CXType_BlockPointer);
-			//lc_tmp_basic_case(::CXTypeKind::CXType_LValueReference);
-			//lc_tmp_basic_case(::CXTypeKind::CXType_RValueReference);
-			// !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!11 lc_tmp_basic_case(::CXTypeKind::CXType_Record);
-			//lc_tmp_basic_case(::CXTypeKind::CXType_Enum);
-			//lc_tmp_basic_case(::CXTypeKind::CXType_Typedef);
-			lc_tmp_basic_case(::CXTypeKind::CXType_ObjCInterface);
-			lc_tmp_basic_case(::CXTypeKind::CXType_ObjCObjectPointer);
-			lc_tmp_basic_case(::CXTypeKind::CXType_FunctionNoProto);
-			lc_tmp_basic_case(::CXTypeKind::CXType_FunctionProto);
-			lc_tmp_basic_case(::CXTypeKind::CXType_ConstantArray);
-			lc_tmp_basic_case(::CXTypeKind::CXType_Vector);
-			lc_tmp_basic_case(::CXTypeKind::CXType_IncompleteArray);
-			lc_tmp_basic_case(::CXTypeKind::CXType_VariableArray);
-			lc_tmp_basic_case(::CXTypeKind::CXType_DependentSizedArray);
-			lc_tmp_basic_case(::CXTypeKind::CXType_MemberPointer);
-			lc_tmp_basic_case(::CXTypeKind::CXType_Auto);
-			//lc_tmp_basic_case(::CXTypeKind::CXType_Elaborated);
-			lc_tmp_basic_case(::CXTypeKind::CXType_Pipe);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage1dRO);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage1dArrayRO);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage1dBufferRO);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dRO);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dArrayRO);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dDepthRO);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dArrayDepthRO);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dMSAARO);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dArrayMSAARO);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dMSAADepthRO);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dArrayMSAADepthRO);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage3dRO);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage1dWO);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage1dArrayWO);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage1dBufferWO);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dWO);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dArrayWO);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dDepthWO);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dArrayDepthWO);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dMSAAWO);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dArrayMSAAWO);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dMSAADepthWO);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dArrayMSAADepthWO);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage3dWO);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage1dRW);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage1dArrayRW);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage1dBufferRW);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dRW);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dArrayRW);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dDepthRW);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dArrayDepthRW);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dMSAARW);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dArrayMSAARW);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dMSAADepthRW);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage2dArrayMSAADepthRW);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLImage3dRW);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLSampler);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLEvent);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLQueue);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLReserveID);
-			lc_tmp_basic_case(::CXTypeKind::CXType_ObjCObject);
-			lc_tmp_basic_case(::CXTypeKind::CXType_ObjCTypeParam);
-			lc_tmp_basic_case(::CXTypeKind::CXType_Attributed);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLIntelSubgroupAVCMcePayload);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLIntelSubgroupAVCImePayload);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLIntelSubgroupAVCRefPayload);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLIntelSubgroupAVCSicPayload);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLIntelSubgroupAVCMceResult);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLIntelSubgroupAVCImeResult);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLIntelSubgroupAVCRefResult);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLIntelSubgroupAVCSicResult);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLIntelSubgroupAVCImeResultSingleRefStreamout);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLIntelSubgroupAVCImeResultDualRefStreamout);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLIntelSubgroupAVCImeSingleRefStreamin);
-			lc_tmp_basic_case(::CXTypeKind::CXType_OCLIntelSubgroupAVCImeDualRefStreamin);
-			lc_tmp_basic_case(::CXTypeKind::CXType_ExtVector);
-			lc_tmp_basic_case(::CXTypeKind::CXType_Atomic);
-#endif
-			// END basic Types
-
-
-
 			default:
-				assert(0);
+				result = make_basic_type(ctype.kind());
+				assert((bool)result);
 				break;
 			}
 
@@ -482,32 +383,300 @@ namespace
 			return result;
 		}
 
-		shared_ptr<CXXType> to_type(const clang::TypeRef& ctype, SymbolRegistry& registry)
+		// the USR of the declaration named by a type, through pointers, references and elaborated types
+		InternedString declaration_usr(clang::TypeRef ctype)
+		{
+			for (;;)
+			{
+				switch (ctype.kind())
+				{
+				case ::CXTypeKind::CXType_Pointer:
+				case ::CXTypeKind::CXType_LValueReference:
+				case ::CXTypeKind::CXType_RValueReference:
+					ctype = ctype.pointee();
+					continue;
+				case ::CXTypeKind::CXType_Elaborated:
+					ctype = ctype.named();
+					continue;
+				default:
+					break;
+				}
+
+				const auto declaration = ctype.declaration();
+				return declaration ? InternedString(declaration.usrString().view()) : InternedString();
+			}
+		}
+
+		shared_ptr<CXXType> to_type(const clang::TypeRef& ctype, Extraction& ex)
 		{
-			// TODO reuse already created types
-			return make_type(ctype, registry);
+			const auto kind = ctype.kind();
+			if (kind == ::CXTypeKind::CXType_Invalid)
+				return nullptr;
+
+			const bool constQualified = ctype.constQualified();
+			const bool volatileQualified = ctype.volatileQualified();
+			if (auto basic = TypeInterner::basic(kind, constQualified, volatileQualified))
+				return basic;
+
+			const TypeInterner::Key key{ kind, constQualified, volatileQualified, ctype.spelling(), ctype.canonical().spelling(), declaration_usr(ctype) };
+			if (auto interned = ex.registry.types.find(key))
+				return interned;
+
+			auto result = make_type(ctype, ex);
+			ex.registry.types.add(key, result);
+			return result;
+		}
+	}
+
+	// the recursive walk of the declarations, see ExtractionFilter
+	namespace walk
+	{
+		using namespace lcdoc;
+		using clang::CursorRef;
+
+		// the kinds whose children are walked: those recorded as the parents of their children
+		// (declarations in an extern "C" block have the enclosing scope as semantic parent)
+		bool descends(::CXCursorKind kind)
+		{
+			switch (kind)
+			{
+			case ::CXCursor_Namespace:
+			case ::CXCursor_ClassDecl:
+			case ::CXCursor_UnexposedDecl:
+			case ::CXCursor_LinkageSpec:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		// ExtractionFilter applied to cursors, with the decisions on files memoized for the unit
+		class DeclarationFilter
+		{
+		public:
+
+			explicit DeclarationFilter(const ExtractionFilter& filter) : m_filter(filter) {}
+
+			// the file rules, only checked on the top level declarations: their children are in the same file
+			bool acceptsFile(const CursorRef::Location& location)
+			{
+				if (m_filter.mainFileOnly())
+					return location.isFromMainFile();
+
+				const ::CXFile file = location.fileHandle();
+				if (!file)
+					return false;
+				if (const auto it = m_files.find(file); it != m_files.end())
+					return it->second;
+
+				const string name = std::filesystem::absolute(location.fileName()).lexically_normal().generic_string();
+				const bool accepted = m_filter.acceptsFile(name, location.isFromMainFile());
+				m_files.emplace(file, accepted);
+				return accepted;
+			}
+
+			// the access and namespace rules, `scope` is the qualified name of the enclosing namespace
+			bool accepts(const CursorRef& cursor, const string& scope) const
+			{
+				if (!m_filter.acceptsAccess(cursor.access()))
+					return false;
+				if (cursor.kind() != ::CXCursor_Namespace || m_filter.excludeNamespaces.empty())
+					return true;
+
+				const string name = cursor.spelling();
+				return m_filter.acceptsNamespace(name, qualified(scope, name));
+			}
+
+			// the scope of the children of `cursor`
+			string scopeOf(const CursorRef& cursor, const string& scope) const
+			{
+				// only the namespace rules need it
+				if (cursor.kind() != ::CXCursor_Namespace || m_filter.excludeNamespaces.empty())
+					return scope;
+				return qualified(scope, cursor.spelling());
+			}
+
+		private:
+
+			static string qualified(const string& scope, const string& name)
+			{
+				return scope.empty() ? name : scope + "::" + name;
+			}
+
+			const ExtractionFilter& m_filter;
+			std::unordered_map<::CXFile, bool> m_files;
+		};
+
+		// records the declarations below `parent` in a single pass, the rejected subtrees are not entered
+		void walk(const CursorRef& parent, const string& scope, DeclarationFilter& filter, gt::Extraction& ex)
+		{
+			const bool topLevel = parent.kind() == ::CXCursor_TranslationUnit;
+			parent.children().forEach([&](const CursorRef& cursor) {
+				if (!cursor.isDeclaration() && !cursor.isDefinition())
+					return;
+				if (topLevel && !filter.acceptsFile(cursor.location()))
+					return;
+				if (!filter.accepts(cursor, scope))
+					return;
+
+				gt::record(cursor, ex);
+
+				if (descends(cursor.kind()))
+					walk(cursor, filter.scopeOf(cursor, scope), filter, ex);
+			});
+		}
+	}
+
+	// clang_indexSourceFile callbacks, the client data is the IndexerState
+	namespace indexer
+	{
+		using namespace lcdoc;
+
+		struct IndexerState
+		{
+			gt::Extraction& ex;
+			walk::DeclarationFilter& filter;
+			vector<path>& includedFiles;
+			vector<clang::Inclusion>& inclusions;
+		};
+
+		string file_name(::CXFile file)
+		{
+			return file ? clang::to_string(clang_getFileName(file)) : string();
+		}
+
+		::CXIdxClientFile ppIncludedFile(::CXClientData data, const ::CXIdxIncludedFileInfo* info)
+		{
+			auto& state = *static_cast<IndexerState*>(data);
+			if (!info->file)
+				return nullptr;
+
+			::CXFile includer = nullptr;
+			clang_indexLoc_getFileLocation(info->hashLoc, nullptr, &includer, nullptr, nullptr, nullptr);
+
+			const path included = file_name(info->file);
+			if (includer)
+				state.inclusions.push_back({ file_name(includer), included });
+			state.includedFiles.push_back(included);
+			return nullptr;
+		}
+
+		void indexDeclaration(::CXClientData data, const ::CXIdxDeclInfo* info)
+		{
+			auto& state = *static_cast<IndexerState*>(data);
+			if (info->isImplicit)
+				return;
+
+			// clang reports every declaration, the walk is replayed on the lexical parents:
+			// the same declarations are recorded, but the rejected subtrees cannot be skipped
+			const clang::CursorRef cursor = info->cursor;
+			vector<clang::CursorRef> parents;
+			for (auto parent = cursor.lexicalParent(); parent && parent.kind() != ::CXCursor_TranslationUnit; parent = parent.lexicalParent())
+				parents.push_back(parent);
+
+			if (!state.filter.acceptsFile((parents.empty() ? cursor : parents.back()).location()))
+				return;
+
+			string scope;
+			for (auto it = parents.rbegin(); it != parents.rend(); ++it)
+			{
+				if (!walk::descends(it->kind()) || !state.filter.accepts(*it, scope))
+					return;
+				scope = state.filter.scopeOf(*it, scope);
+			}
+			if (!state.filter.accepts(cursor, scope))
+				return;
+
+			gt::record(cursor, state.ex);
 		}
 	}
 }
 
 namespace lcdoc
 {
-	void CXXDocumentParser::parse(const path& fileName, const vector<string>& args)
+	void CXXDocumentParser::parse(const path& fileName, const vector<string>& args, unsigned flags)
 	{
+		if (this->backend == ExtractionBackend::Indexer)
+		{
+			this->indexSource(fileName, args, flags);
+			return;
+		}
+
 		clang::TranslationUnit TU(
 			m_index,
 			fileName,
-			args
+			args,
 			//{ "-DPIPPO_", "-std=c++20", "-IC:/Program Files/LLVM/include" }
+			flags
 		);
 
-		for (const auto& cursor : TU.cursor().listChildren())
-		{
-			if (!cursor.location().isFromMainFile())
-				continue;
+		this->extract(TU);
 
-			if (cursor.isDeclaration() || cursor.isDefinition())
-				gt::record(cursor, this->registry);
+		// the symbols own their data, the AST can go before the registry is handed over
+		TU.dispose();
+	}
+
+	void CXXDocumentParser::extract(clang::TranslationUnit& TU)
+	{
+		this->includedFiles.clear();
+		this->inclusions.clear();
+		this->memoryUsage = TU.memoryUsage();
+
+		if (!TU)
+		{
+			std::cerr << "failed to parse translation unit (error " << (int)TU.error() << ")" << std::endl;
+			return;
 		}
+
+		gt::Extraction ex{ this->registry };
+		walk::DeclarationFilter filter(this->filter);
+		walk::walk(TU.cursor(), {}, filter, ex);
+
+		this->includedFiles = TU.inclusions();
+		this->inclusions = TU.includeGraph();
 	}
-}
\ No newline at end of file
+
+	void CXXDocumentParser::indexSource(const path& fileName, const vector<string>& args, unsigned flags)
+	{
+		this->includedFiles.clear();
+		this->inclusions.clear();
+		this->memoryUsage = 0;
+
+		if (!m_action)
+			m_action = std::make_unique<clang::IndexAction>(m_index);
+
+		vector<const char*> cargs;
+		for (const auto& arg : args)
+			cargs.push_back(arg.c_str());
+
+		gt::Extraction ex{ this->registry };
+		walk::DeclarationFilter filter(this->filter);
+		indexer::IndexerState state{ ex, filter, this->includedFiles, this->inclusions };
+
+		::IndexerCallbacks callbacks{};
+		callbacks.ppIncludedFile = &indexer::ppIncludedFile;
+		callbacks.indexDeclaration = &indexer::indexDeclaration;
+
+		// the unit is only kept to measure it
+		::CXTranslationUnit unit = nullptr;
+		const int error = clang_indexSourceFile(
+			m_action->handle(),
+			&state,
+			&callbacks, sizeof(callbacks),
+			::CXIndexOpt_SuppressRedundantRefs | ::CXIndexOpt_SkipParsedBodiesInSession,
+			fileName.string().c_str(),
+			cargs.data(), (int)cargs.size(),
+			nullptr, 0,
+			&unit,
+			flags
+		);
+
+		clang::TranslationUnit TU(unit);
+		this->memoryUsage = TU.memoryUsage();
+		TU.dispose();
+
+		// the declarations already reported are kept, as with the cursors of a unit parsed with errors
+		if (error != 0)
+			std::cerr << "failed to index translation unit " << fileName << " (error " << error << ")" << std::endl;
+	}
+}
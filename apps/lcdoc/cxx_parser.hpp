@@ -1,7 +1,10 @@
 #pragma once
 
 #include "clang_interface/Index.hpp"
+#include "clang_interface/IndexAction.hpp"
+#include "clang_interface/TranslationUnit.hpp"
 #include "Symbol.hpp"
+#include "ExtractionFilter.hpp"
 
 namespace lcdoc
 {
@@ -9,16 +12,52 @@ namespace lcdoc
 	using std::vector;
 	using std::filesystem::path;
 
+	// how the symbols are extracted from a translation unit
+	enum class ExtractionBackend
+	{
+		// the AST is built, then its top level cursors are walked
+		Cursors,
+
+		// clang_indexSourceFile reports the declarations while it parses, and they are recorded as they come
+		Indexer,
+	};
+
 	class CXXDocumentParser
 	{
 	public:
 
 		SymbolRegistry registry;
 
-		void parse(const path& fileName, const vector<string>& args);
+		// files included by the last parsed translation unit
+		vector<path> includedFiles;
+
+		// the #include edges of the last parsed translation unit
+		vector<clang::Inclusion> inclusions;
+
+		// bytes used by libclang for the last parsed translation unit
+		uint64_t memoryUsage = 0;
+
+		// used by parse(), extract() always walks the cursors of the unit it is given
+		ExtractionBackend backend = ExtractionBackend::Cursors;
+
+		// the declarations extracted, by both backends
+		ExtractionFilter filter;
+
+		// `flags` are CXTranslationUnit_Flags, see CXXParseMode
+		void parse(const path& fileName, const vector<string>& args, unsigned flags = ::CXTranslationUnit_DetailedPreprocessingRecord);
+
+		// records the symbols of an already parsed translation unit
+		void extract(clang::TranslationUnit& TU);
+
+		const clang::Index& index() const { return m_index; }
 
 	private:
+		void indexSource(const path& fileName, const vector<string>& args, unsigned flags);
+
 		clang::Index m_index;
+
+		// created by the first unit indexed, then shared by the next ones
+		unique_ptr<clang::IndexAction> m_action;
 	};
 
 	void ci();
@@ -0,0 +1,195 @@
+#include <fstream>
+#include <sstream>
+#include <mutex>
+#include <memory>
+#include <unordered_map>
+
+#include "doc_comment.hpp"
+
+namespace lcdoc
+{
+	namespace
+	{
+		struct CommentSources
+		{
+			std::mutex mutex;
+			std::unordered_map<uint32_t, std::shared_ptr<const string>> files; // by interned file name
+		};
+
+		CommentSources& comment_sources()
+		{
+			static CommentSources sources;
+			return sources;
+		}
+
+		std::shared_ptr<const string> source_of(const InternedString& file)
+		{
+			auto& sources = comment_sources();
+			{
+				std::lock_guard lock(sources.mutex);
+				if (const auto it = sources.files.find(file.handle()); it != sources.files.end())
+					return it->second;
+			}
+
+			// read without the lock, at worst twice
+			std::ifstream in(file.str(), std::ios::binary);
+			std::ostringstream content;
+			if (in)
+				content << in.rdbuf();
+			auto text = std::make_shared<const string>(std::move(content).str());
+
+			std::lock_guard lock(sources.mutex);
+			return sources.files.emplace(file.handle(), std::move(text)).first->second;
+		}
+
+		std::string_view trim(std::string_view s)
+		{
+			const auto first = s.find_first_not_of(" \t\r");
+			if (first == std::string_view::npos)
+				return {};
+			const auto last = s.find_last_not_of(" \t\r");
+			return s.substr(first, last - first + 1);
+		}
+
+		// the text of a comment line without its markers
+		std::string_view strip_markers(std::string_view line)
+		{
+			line = trim(line);
+			for (const std::string_view marker : { "///<", "//!<", "///", "//!", "//", "/**<", "/*!<", "/**", "/*!", "/*" })
+				if (line.starts_with(marker))
+				{
+					line.remove_prefix(marker.size());
+					break;
+				}
+			if (line.ends_with("*/"))
+				line.remove_suffix(2);
+			line = trim(line);
+			// the leading * of the lines of a block comment
+			if (line.starts_with("*") && !line.starts_with("*/"))
+				line = trim(line.substr(1));
+			return line;
+		}
+
+		void append(string& to, std::string_view text)
+		{
+			if (text.empty())
+				return;
+			if (!to.empty())
+				to += ' ';
+			to += text;
+		}
+	}
+
+	string read_comment(const CommentRange& range)
+	{
+		if (!range)
+			return {};
+
+		const auto source = source_of(range.file);
+		if (range.end > source->size())
+			return {};
+		return source->substr(range.begin, range.size());
+	}
+
+	void forget_comment_sources()
+	{
+		auto& sources = comment_sources();
+		std::lock_guard lock(sources.mutex);
+		sources.files.clear();
+	}
+
+	ParsedComment parse_comment(std::string_view raw)
+	{
+		ParsedComment comment;
+
+		enum class Section { Brief, Details, Param, Returns, See };
+		Section section = Section::Brief;
+		bool explicitBrief = false;
+
+		size_t from = 0;
+		while (from <= raw.size())
+		{
+			const size_t to = std::min(raw.find('\n', from), raw.size());
+			std::string_view line = strip_markers(raw.substr(from, to - from));
+			from = to + 1;
+
+			if (line.empty())
+			{
+				// a blank line ends the implicit brief and any command
+				if (section != Section::Brief || !comment.brief.empty())
+					section = Section::Details;
+				continue;
+			}
+
+			if (line[0] == '\\' || line[0] == '@')
+			{
+				const auto end = line.find_first_of(" \t");
+				const std::string_view command = line.substr(1, end == std::string_view::npos ? line.size() - 1 : end - 1);
+				std::string_view rest = end == std::string_view::npos ? std::string_view() : trim(line.substr(end));
+
+				if (command == "brief" || command == "short")
+				{
+					// the first paragraph was not the brief after all
+					if (!explicitBrief && !comment.brief.empty())
+					{
+						string details = std::move(comment.brief);
+						append(details, comment.details);
+						comment.details = std::move(details);
+						comment.brief.clear();
+					}
+					explicitBrief = true;
+					section = Section::Brief;
+					append(comment.brief, rest);
+					continue;
+				}
+				if (command.starts_with("param") || command == "tparam")
+				{
+					const auto nameEnd = rest.find_first_of(" \t");
+					const std::string_view name = rest.substr(0, nameEnd);
+					const std::string_view description = nameEnd == std::string_view::npos ? std::string_view() : trim(rest.substr(nameEnd));
+					comment.params.emplace_back(string(name), string(description));
+					section = Section::Param;
+					continue;
+				}
+				if (command == "return" || command == "returns" || command == "result")
+				{
+					section = Section::Returns;
+					append(comment.returns, rest);
+					continue;
+				}
+				if (command == "see" || command == "sa")
+				{
+					section = Section::See;
+					if (!rest.empty())
+						comment.seeAlso.emplace_back(rest);
+					continue;
+				}
+				// other commands are kept as text
+			}
+
+			switch (section)
+			{
+			case Section::Brief:
+				append(comment.brief, line);
+				break;
+			case Section::Details:
+				append(comment.details, line);
+				break;
+			case Section::Param:
+				append(comment.params.back().second, line);
+				break;
+			case Section::Returns:
+				append(comment.returns, line);
+				break;
+			case Section::See:
+				if (comment.seeAlso.empty())
+					comment.seeAlso.emplace_back(line);
+				else
+					append(comment.seeAlso.back(), line);
+				break;
+			}
+		}
+
+		return comment;
+	}
+}
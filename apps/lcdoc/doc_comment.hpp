@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+#include "StringPool.hpp"
+
+namespace lcdoc
+{
+	using std::string;
+	using std::vector;
+
+	// where the doc comment of a declaration is in its source file, in bytes
+	struct CommentRange
+	{
+		InternedString file;
+		uint32_t begin = 0;
+		uint32_t end = 0;
+
+		uint32_t size() const { return this->end > this->begin ? this->end - this->begin : 0; }
+
+		explicit operator bool() const { return !this->file.empty() && this->size() > 0; }
+	};
+
+	// a doc comment split into its Doxygen / Javadoc commands
+	struct ParsedComment
+	{
+		string brief;
+		string details;
+		vector<std::pair<string, string>> params; // name, description
+		string returns;
+		vector<string> seeAlso;
+	};
+
+	// The text of `range`, read from its file. Each file is read once and kept in memory until
+	// forget_comment_sources(); the text is empty if the file is gone or shorter than the range.
+	string read_comment(const CommentRange& range);
+
+	// drops the files kept by read_comment(), e.g. because the sources changed since the last parse
+	void forget_comment_sources();
+
+	// Strips the comment markers (///, //!, /** */, /*! */, leading *) and splits the commands \brief, \param,
+	// \return(s), \see and \sa (or with @). Without \brief, the first paragraph is the brief, as clang does
+	ParsedComment parse_comment(std::string_view raw);
+}
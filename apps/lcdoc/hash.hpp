@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <format>
+
+namespace lcdoc
+{
+	using std::string;
+	using std::optional;
+	using std::filesystem::path;
+
+	// 64 bit FNV-1a, used for cache keys (not a cryptographic hash)
+	inline constexpr uint64_t fnv1a_basis = 14695981039346656037ull;
+
+	constexpr uint64_t hash_bytes(std::string_view bytes, uint64_t hash = fnv1a_basis)
+	{
+		for (const char c : bytes)
+		{
+			hash ^= (uint8_t)c;
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	constexpr uint64_t hash_combine(uint64_t hash, uint64_t value)
+	{
+		for (int i = 0; i < 8; ++i)
+		{
+			hash ^= (value >> (8 * i)) & 0xff;
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	// splitmix64 finalizer of a hash combined with a seed, used by the perfect hash of the frozen registry
+	constexpr uint64_t hash_seeded(uint64_t hash, uint64_t seed)
+	{
+		uint64_t z = hash + seed * 0x9e3779b97f4a7c15ull;
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	}
+
+	// slot of a key in a hash and displace table, see FrozenRegistry
+	constexpr uint32_t perfect_hash_slot(uint64_t hash, int32_t seed, uint32_t size)
+	{
+		return seed < 0 ? (uint32_t)(-seed - 1) : (uint32_t)(hash_seeded(hash, (uint32_t)seed) % size);
+	}
+
+	// hash of the content of a file, nullopt if the file cannot be read
+	inline optional<uint64_t> hash_file(const path& file)
+	{
+		std::ifstream in(file, std::ios::binary);
+		if (!in)
+			return std::nullopt;
+
+		uint64_t hash = fnv1a_basis;
+		char buffer[1 << 16];
+		while (in.read(buffer, sizeof(buffer)) || in.gcount() > 0)
+			hash = hash_bytes(std::string_view(buffer, (size_t)in.gcount()), hash);
+		return hash;
+	}
+
+	inline string to_hex(uint64_t hash)
+	{
+		return std::format("{:016x}", hash);
+	}
+}
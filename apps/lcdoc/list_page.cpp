@@ -2,6 +2,7 @@
 #include <fstream>
 #include <cassert>
 #include <set>
+#include <algorithm>
 
 #include "html_page.hpp"
 
@@ -34,6 +35,9 @@ namespace lcdoc
 		set<Keyword> usedKeywords;
 		set<Punctuation> usedPunctuation;
 
+		// resolves the parents of the symbols
+		const FrozenRegistry* registry = nullptr;
+
 		CxxDocHtmlArticle();
 
 		static string tooltip(const string& content, const string& tooltip);
@@ -204,9 +208,12 @@ example:
 
 		// TODO link and tooltip if possible
 		const string parent = [&symbol, this]() -> string {
-			if (auto p = symbol->parent.lock())
-				return this->to_html(std::dynamic_pointer_cast<const CXXSymbol>(p));
-			return "";
+			if (!this->registry)
+				return "";
+			const uint32_t index = this->registry->indexOf(symbol->usr());
+			if (index == no_symbol || this->registry->parent(index) == no_symbol)
+				return "";
+			return this->to_html(std::dynamic_pointer_cast<const CXXSymbol>(this->registry->symbols()[this->registry->parent(index)]));
 		}();
 
 		if (const auto f = std::dynamic_pointer_cast<const FunctionSymbol>(symbol))
@@ -331,35 +338,35 @@ example:
 			this->defs["rvalueref-tooltip"] = R"a<nfnos(<i>R-value reference</i>, see <a href="https://en.cppreference.com/w/cpp/language/reference">reference declaration</a> and <a href="https://learn.microsoft.com/en-us/cpp/cpp/rvalue-reference-declarator-amp-amp?view=msvc-170">R-value reference declaration</a>)a<nfnos";
 	}
 
-	void write_list_page(const path& fileName, const SymbolRegistry& registry)
+	void write_list_page(const path& fileName, const FrozenRegistry& registry)
 	{
 		CxxDocHtmlArticle article;
+		article.registry = &registry;
 
 		article.article = "<h1>ciao</h1> ciao <h2>ciao</h2><h2>ciao</h2>";
 
-		for (const auto& [id, symbol] : registry.symbolsById)
+		// sorted by qualified name
+		for (const uint32_t index : registry.ofKind(SymbolKind::Function))
 		{
-			if (auto f = std::dynamic_pointer_cast<FunctionSymbol>(symbol))
+			const auto f = std::static_pointer_cast<const FunctionSymbol>(registry.symbols()[index]);
+
+			string code;
+			if (f->signature)
+				code += article.to_html(std::dynamic_pointer_cast<CXXType>(f->signature->ret)) + " ";
+			code += article.to_html(f);
+			code += "(";
+			vector<string> args;
+			for (const auto& arg : f->signature->args)
 			{
-				string code;
-				if (f->signature)
-					code += article.to_html(std::dynamic_pointer_cast<CXXType>(f->signature->ret)) + " ";
-				code += article.to_html(f);
-				code += "(";
-				vector<string> args;
-				for (const auto& arg : f->signature->args)
-				{
-					string a;
-					a += article.to_html(std::dynamic_pointer_cast<CXXType>(arg.type));
-					string name = arg.name.empty() ? "" : (" "s + arg.name);
-					a += "<code-pvar>"s + name + "</code-pvar>";
-					args.push_back(a);
-				}
-				code += join(args, ", ");
-				code += ")";
-				article.article += std::format(R"(<div clas="p"><pre><code>{0}</code></pre></div>)", code);
-				
+				string a;
+				a += article.to_html(std::dynamic_pointer_cast<CXXType>(arg.type));
+				string name = arg.name.empty() ? "" : (" "s + arg.name.str());
+				a += "<code-pvar>"s + name + "</code-pvar>";
+				args.push_back(a);
 			}
+			code += join(args, ", ");
+			code += ")";
+			article.article += std::format(R"(<div clas="p"><pre><code>{0}</code></pre></div>)", code);
 		}
 
 		article.finish();
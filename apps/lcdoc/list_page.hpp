@@ -1,10 +1,10 @@
 #pragma once
 
-#include "Symbol.hpp"
+#include "FrozenRegistry.hpp"
 
 namespace lcdoc
 {
 
 
-	void write_list_page(const path& fileName, const SymbolRegistry& registry);
+	void write_list_page(const path& fileName, const FrozenRegistry& registry);
 }
\ No newline at end of file
@@ -6,6 +6,9 @@
 #include <fstream>
 #include <set>
 #include <cassert>
+#include <thread>
+#include <mutex>
+#include <chrono>
 
 #include <cmrc/cmrc.hpp>
 
@@ -20,6 +23,9 @@
 #include "list_page.hpp"
 #include "Project.hpp"
 #include "parse_project.hpp"
+#include "IncrementalParser.hpp"
+#include "Shard.hpp"
+#include "memory_usage.hpp"
 
 #include "UpdateListener.hpp"
 
@@ -69,6 +75,48 @@ int main(int argc, const char* argv[])
 		.default_value(false)
 		.implicit_value(true);
 
+	program
+		.add_argument("-j", "--jobs")
+		.help("number of translation units parsed in parallel, 0 uses all the hardware threads (overrides the project file)")
+		.scan<'u', unsigned>();
+
+	program
+		.add_argument("--isolated")
+		.help("parse every translation unit in a forked worker process, a crash costs only that unit (overrides the project file)")
+		.default_value(false)
+		.implicit_value(true);
+
+	program
+		.add_argument("--parse-timeout")
+		.help("seconds an isolated worker may spend on a translation unit before it is killed, 0 for no limit (overrides the project file)")
+		.scan<'u', unsigned>();
+
+	program
+		.add_argument("--max-memory")
+		.help("memory budget in MiB of the translation units parsed at once, estimated from the previous runs, 0 for no limit (overrides the project file)")
+		.scan<'u', unsigned>();
+
+	program
+		.add_argument("--emit")
+		.help("parse the project, write its .lcdx index to the given file and exit");
+
+	program
+		.add_argument("--index")
+		.help("generate the documentation from a .lcdx index instead of parsing the project");
+
+	program
+		.add_argument("--shard")
+		.help("parse only the shard i/N of the input files (1 <= i <= N) and write its partial registry to --partial");
+
+	program
+		.add_argument("--partial")
+		.help("the partial registry written by --shard");
+
+	program
+		.add_argument("--merge")
+		.help("merge the partial registries of all the shards instead of parsing the project (repeat for every file)")
+		.append();
+
 	try
 	{
 		program.parse_args(argc, argv);
@@ -100,29 +148,187 @@ int main(int argc, const char* argv[])
 		return 0;
 	}
 
-	auto parsed = parse(project);
+	if (const auto jobs = program.present<unsigned>("--jobs"))
+		project->jobs = *jobs;
+
+	if (program["--isolated"] == true)
+		project->isolatedParsing = true;
+
+	if (const auto timeout = program.present<unsigned>("--parse-timeout"))
+		project->parseTimeout = *timeout;
+
+	if (const auto maxMemory = program.present<unsigned>("--max-memory"))
+		project->maxParseMemory = (uint64_t)*maxMemory << 20;
+
+	const bool watch = program["--watch"] == true;
+	const auto emitFile = program.present<string>("--emit");
+	const auto indexFile = program.present<string>("--index");
+
+	const auto shardSpec = program.present<string>("--shard");
+	const auto partialFile = program.present<string>("--partial");
+	const auto mergeFiles = program.present<vector<string>>("--merge");
+
+	if ((emitFile || shardSpec || mergeFiles) && indexFile)
+	{
+		std::cerr << "--index cannot be used with --emit, --shard or --merge" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	if (shardSpec)
+	{
+		if (!partialFile || mergeFiles)
+		{
+			std::cerr << "--shard requires --partial and cannot be used with --merge" << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		try
+		{
+			const Shard shard = Shard::parse(*shardSpec);
+			const size_t inputFiles = project->inputFiles.size();
+			const auto [first, last] = shard.range(inputFiles);
+			project->inputFiles = vector<CXXInputSourceFile>(project->inputFiles.begin() + first, project->inputFiles.begin() + last);
+			std::cout << "shard " << shard.index << "/" << shard.count << ": " << project->inputFiles.size() << " of " << inputFiles << " translation units" << std::endl;
+
+			write_partial(*partialFile, shard, inputFiles, parse(project)->registry);
+		}
+		catch (const exception& e)
+		{
+			std::cerr << "failed to parse the shard: " << e.what() << std::endl;
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+
+	// the registry of the whole project, parsed here or merged from the shards
+	const auto parseProject = [&]() -> shared_ptr<ParsedCXXProject> {
+		if (!mergeFiles)
+			return parse(project);
+
+		auto parsed = make_shared<ParsedCXXProject>();
+		parsed->project = project;
+		parsed->registry = merge_partials(vector<path>(mergeFiles->begin(), mergeFiles->end()));
+		parsed->freeze();
+		return parsed;
+	};
+
+	if (emitFile)
+	{
+		try
+		{
+			write_index(*emitFile, *parseProject()->frozen);
+		}
+		catch (const exception& e)
+		{
+			std::cerr << "failed to write the index: " << e.what() << std::endl;
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+
+	// in watch mode the translation units are kept alive and reparsed incrementally,
+	// unless the symbols come from an index or from the shards
+	const bool incremental = watch && !indexFile && !mergeFiles;
+	IncrementalParser incrementalParser(project);
+	shared_ptr<ParsedCXXProject> parsed;
+	if (indexFile)
+	{
+		parsed = make_shared<ParsedCXXProject>();
+		parsed->project = project;
+		try
+		{
+			parsed->index = make_shared<const ProjectIndex>(*indexFile);
+		}
+		catch (const exception& e)
+		{
+			std::cerr << "failed to load the index: " << e.what() << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	else
+	{
+		try
+		{
+			parsed = incremental ? incrementalParser.parse() : parseProject();
+		}
+		catch (const exception& e)
+		{
+			std::cerr << "failed to parse the project: " << e.what() << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
 
 	Generator generator(project, parsed);
 
-	generator.generate();
+	{
+		MemoryPhase phase("generating");
+		generator.generate();
+	}
 
-	if (program["--watch"] == true)
+	if (watch)
 	{
 		efsw::FileWatcher fileWatcher;
 
 		FuncitonalUpdateListener listener;
 
-		listener.boldLstener = [&]() {
-			generator.generate();
+		// the events come from the watcher thread, they are handled in batches by the loop below
+		std::mutex changesMutex;
+		std::set<path> changes;
+
+		listener.listener = [&](efsw::WatchID watchid, const std::string& dir, const std::string& filename, efsw::Action action, std::string oldFilename) {
+			std::lock_guard lock(changesMutex);
+			changes.insert((path(dir) / filename).lexically_normal());
+		};
+
+		// efsw reports absolute paths, the directories of the project can be relative (outDir is "./out2" by default)
+		const auto isInside = [](const path& file, const path& dir) -> bool {
+			const path relative = std::filesystem::absolute(file).lexically_normal().lexically_relative(std::filesystem::absolute(dir).lexically_normal());
+			return !relative.empty() && *relative.begin() != "..";
 		};
 
-		const auto watchID = fileWatcher.addWatch(project->inputDir.string(), &listener, true);
+		// documentation sources
+		fileWatcher.addWatch(project->inputDir.string(), &listener, true);
+
+		// C++ sources and headers
+		fileWatcher.addWatch(project->rootDir.string(), &listener, true);
 
 		fileWatcher.watch();
 
 		// loop forever
 		while (true)
-			std::this_thread::yield();
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+			std::set<path> changed;
+			{
+				std::lock_guard lock(changesMutex);
+				changed.swap(changes);
+			}
+
+			std::set<path> sources;
+			bool regenerate = false;
+			for (const auto& file : changed)
+			{
+				// our own output and cache
+				if (isInside(file, project->outDir) || (!project->cacheDir.empty() && isInside(file, project->cacheDir)))
+					continue;
+
+				// the sources of an index or of the shards are not watched, only the documentation is regenerated
+				if (incremental && incrementalParser.isDependency(file))
+				{
+					sources.insert(file);
+					regenerate = true;
+				}
+				else if (isInside(file, project->inputDir))
+					regenerate = true;
+			}
+
+			if (!sources.empty())
+				incrementalParser.update(sources);
+
+			if (regenerate)
+				generator.generate();
+		}
 	}
 
 	return EXIT_SUCCESS;
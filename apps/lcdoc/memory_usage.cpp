@@ -0,0 +1,102 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <format>
+#include <optional>
+
+#ifdef WIN32
+#define NOMINMAX
+#include <Windows.h>
+#include <Psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "memory_usage.hpp"
+
+namespace lcdoc
+{
+	using std::optional;
+
+	namespace
+	{
+#ifdef __linux__
+		// the high-water mark of the memory of the process, the one reset by clear_refs, see proc(5)
+		optional<uint64_t> vm_hwm()
+		{
+			std::ifstream status("/proc/self/status");
+			string line;
+			while (std::getline(status, line))
+				if (line.starts_with("VmHWM:"))
+				{
+					std::istringstream value(line.substr(6));
+					uint64_t kB = 0;
+					if (value >> kB)
+						return kB * 1024;
+				}
+			return std::nullopt;
+		}
+#endif
+	}
+
+	PeakRss peak_rss()
+	{
+		PeakRss peak;
+#ifdef WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			peak.self = counters.PeakWorkingSetSize;
+#else
+		// ru_maxrss is in kilobytes on Linux, in bytes on macOS
+#ifdef __APPLE__
+		constexpr uint64_t unit = 1;
+#else
+		constexpr uint64_t unit = 1024;
+#endif
+		struct rusage usage;
+#ifdef __linux__
+		// ru_maxrss also keeps the peak of the exited threads, it is not reset by reset_peak_rss()
+		if (const auto hwm = vm_hwm())
+			peak.self = *hwm;
+		else
+#endif
+		if (::getrusage(RUSAGE_SELF, &usage) == 0)
+			peak.self = (uint64_t)usage.ru_maxrss * unit;
+		if (::getrusage(RUSAGE_CHILDREN, &usage) == 0)
+			peak.children = (uint64_t)usage.ru_maxrss * unit;
+#endif
+		return peak;
+	}
+
+	bool reset_peak_rss()
+	{
+#ifdef __linux__
+		// see proc(5), /proc/pid/clear_refs
+		std::ofstream clear("/proc/self/clear_refs");
+		clear << "5";
+		clear.flush();
+		return (bool)clear;
+#else
+		return false;
+#endif
+	}
+
+	MemoryPhase::MemoryPhase(string name) :
+		m_name(std::move(name)),
+		m_reset(reset_peak_rss()),
+		m_start(std::chrono::steady_clock::now())
+	{
+	}
+
+	MemoryPhase::~MemoryPhase()
+	{
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+		const PeakRss peak = peak_rss();
+		constexpr double MiB = 1024.0 * 1024.0;
+
+		string message = std::format("{}: {:.1f}s, peak RSS {:.0f} MiB{}", m_name, seconds, peak.self / MiB, m_reset ? "" : " (since the start)");
+		if (peak.children > 0)
+			message += std::format(", workers {:.0f} MiB", peak.children / MiB);
+		std::cout << message << std::endl;
+	}
+}
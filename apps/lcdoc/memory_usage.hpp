@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <chrono>
+#include <cstdint>
+
+namespace lcdoc
+{
+	using std::string;
+
+	// peak resident set size, in bytes (0 where it cannot be measured)
+	struct PeakRss
+	{
+		uint64_t self = 0;
+		uint64_t children = 0; // the largest of the terminated child processes, e.g. the isolated workers
+	};
+
+	PeakRss peak_rss();
+
+	// restarts the measure of the peak of the process, so that peak_rss() covers a single phase.
+	// Only supported on Linux, returns false elsewhere (the peak is then the one since the start)
+	bool reset_peak_rss();
+
+	// Prints the duration and the peak RSS of a phase of the run when destroyed, to size the machines running lcdoc
+	class MemoryPhase
+	{
+	public:
+
+		explicit MemoryPhase(string name);
+
+		MemoryPhase(const MemoryPhase&) = delete;
+		MemoryPhase& operator=(const MemoryPhase&) = delete;
+
+		~MemoryPhase();
+
+	private:
+		string m_name;
+		bool m_reset;
+		std::chrono::steady_clock::time_point m_start;
+	};
+}
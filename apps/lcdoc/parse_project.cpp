@@ -1,8 +1,12 @@
 
+#include <iostream>
+
 #include <yaml-cpp/yaml.h>
 
 #include <glob/glob.h>
 
+#include "clang_interface/CompilationDatabase.hpp"
+
 #include "parse_project.hpp"
 
 using std::string;
@@ -72,6 +76,40 @@ namespace lcdoc
 				for (const auto& undefine : yaml["undefines"])
 					if (nonEmptyString(undefine))
 						options.undefines.insert(undefine.as<string>());
+
+			// parse mode
+			const auto& parseMode = yaml["parseMode"];
+			if (parseMode.IsDefined())
+			{
+				// preset, example:
+				// parseMode: declarations
+				if (nonEmptyString(parseMode))
+				{
+					const string preset = parseMode.as<string>();
+					if (preset == "declarations")
+						options.parseMode = CXXParseMode::declarations();
+					else if (preset == "full")
+						options.parseMode = CXXParseMode{ false, false, false, false, true };
+					else
+						throw std::runtime_error("unknown parseMode " + preset + ", expected declarations or full");
+				}
+
+				// flags, example:
+				// parseMode:
+				//   skipFunctionBodies: true
+				if (parseMode.IsMap())
+				{
+					const auto flag = [&](const char* name, std::optional<bool>& value) {
+						if (parseMode[name].IsDefined())
+							value = parseMode[name].as<bool>();
+					};
+					flag("skipFunctionBodies", options.parseMode.skipFunctionBodies);
+					flag("limitSkipFunctionBodiesToPreamble", options.parseMode.limitSkipFunctionBodiesToPreamble);
+					flag("incomplete", options.parseMode.incomplete);
+					flag("keepGoing", options.parseMode.keepGoing);
+					flag("detailedPreprocessingRecord", options.parseMode.detailedPreprocessingRecord);
+				}
+			}
 		}
 	}
 
@@ -264,9 +302,37 @@ namespace lcdoc
 				else
 					throw runtime_error("files must be a sequence of strings");
 			}
-			else
+			else if (!yaml["compilationDatabase"].IsDefined())
 				throw runtime_error("\"property inputFiles of type sequence of strings is required\"");
 
+			// compilation database, example:
+			// compilationDatabase: build/
+			if (isStringProperty(yaml, "compilationDatabase"))
+			{
+				path dir = resolveProjectPath(yaml["compilationDatabase"].as<string>());
+				if (dir.filename() == "compile_commands.json")
+					dir = dir.parent_path();
+				project->compilationDatabase = dir;
+
+				set<path> known;
+				for (const auto& file : project->inputFiles)
+					known.insert(path(file.path).lexically_normal());
+
+				// a file compiled several times is parsed with its first command
+				for (auto& command : clang::CompilationDatabase(dir).commands())
+				{
+					if (!known.insert(command.file).second)
+						continue;
+
+					lcdoc::CXXInputSourceFile file;
+					file.path = command.file.string();
+					file.compileArgs = project->arguments.intern(std::move(command.args));
+					project->inputFiles.push_back(std::move(file));
+				}
+			}
+			else if (yaml["compilationDatabase"].IsDefined())
+				throw runtime_error("compilationDatabase must be a string");
+
 			// templates
 			if (yaml["templates"].IsDefined())
 			{
@@ -287,6 +353,108 @@ namespace lcdoc
 				}
 			}
 
+			// jobs
+			if (yaml["jobs"].IsDefined())
+			{
+				if (yaml["jobs"].IsScalar() && yaml["jobs"].as<int>() >= 0)
+					project->jobs = yaml["jobs"].as<unsigned>();
+				else
+					throw runtime_error("jobs must be a non negative integer");
+			}
+
+			// cache directory
+			if (isStringProperty(yaml, "cacheDir"))
+				project->cacheDir = resolveProjectPath(yaml["cacheDir"].as<string>());
+			else if (yaml["cacheDir"].IsDefined())
+				throw runtime_error("cacheDir must be a string");
+
+			// precompiled headers
+			if (yaml["precompiledHeaders"].IsDefined())
+				project->precompiledHeaders = yaml["precompiledHeaders"].as<bool>();
+
+			// memory budget of the parallel parse, in MiB
+			if (yaml["maxParseMemory"].IsDefined())
+			{
+				if (yaml["maxParseMemory"].IsScalar() && yaml["maxParseMemory"].as<int>() >= 0)
+					project->maxParseMemory = yaml["maxParseMemory"].as<uint64_t>() << 20;
+				else
+					throw runtime_error("maxParseMemory must be a non negative integer (MiB)");
+			}
+
+			// extraction backend
+			if (isStringProperty(yaml, "extraction"))
+			{
+				const auto extraction = yaml["extraction"].as<string>();
+				if (extraction == "cursors")
+					project->extraction = ExtractionBackend::Cursors;
+				else if (extraction == "indexer")
+					project->extraction = ExtractionBackend::Indexer;
+				else
+					throw runtime_error("extraction must be \"cursors\" or \"indexer\"");
+			}
+			else if (yaml["extraction"].IsDefined())
+				throw runtime_error("extraction must be a string");
+
+			// extraction rules
+			if (yaml["extract"].IsDefined())
+			{
+				const auto& extract = yaml["extract"];
+				if (!extract.IsMap())
+					throw runtime_error("extract must be a map");
+
+				const auto patterns = [&](const string& property) {
+					vector<string> patterns;
+					if (!extract[property].IsDefined())
+						return patterns;
+					if (!extract[property].IsSequence())
+						throw runtime_error("extract." + property + " must be a sequence of strings");
+					for (const auto& pattern : extract[property])
+						patterns.push_back(pattern.as<string>());
+					return patterns;
+				};
+
+				for (const auto& pattern : patterns("includePaths"))
+					project->extractionFilter.includePaths.push_back(resolveProjectPath(pattern).lexically_normal().generic_string());
+				for (const auto& pattern : patterns("excludePaths"))
+					project->extractionFilter.excludePaths.push_back(resolveProjectPath(pattern).lexically_normal().generic_string());
+				project->extractionFilter.excludeNamespaces = patterns("excludeNamespaces");
+
+				if (isStringProperty(extract, "access"))
+				{
+					const auto access = extract["access"].as<string>();
+					if (access == "public")
+						project->extractionFilter.access = ::CX_CXXPublic;
+					else if (access == "protected")
+						project->extractionFilter.access = ::CX_CXXProtected;
+					else if (access == "private")
+						project->extractionFilter.access = ::CX_CXXPrivate;
+					else
+						throw runtime_error("extract.access must be \"public\", \"protected\" or \"private\"");
+				}
+				else if (extract["access"].IsDefined())
+					throw runtime_error("extract.access must be a string");
+			}
+
+			// isolated parsing
+			if (yaml["isolatedParsing"].IsDefined())
+				project->isolatedParsing = yaml["isolatedParsing"].as<bool>();
+
+			if (yaml["parseTimeout"].IsDefined())
+			{
+				if (yaml["parseTimeout"].IsScalar() && yaml["parseTimeout"].as<int>() >= 0)
+					project->parseTimeout = yaml["parseTimeout"].as<unsigned>();
+				else
+					throw runtime_error("parseTimeout must be a non negative integer");
+			}
+
+			if (yaml["parseRetries"].IsDefined())
+			{
+				if (yaml["parseRetries"].IsScalar() && yaml["parseRetries"].as<int>() >= 0)
+					project->parseRetries = yaml["parseRetries"].as<unsigned>();
+				else
+					throw runtime_error("parseRetries must be a non negative integer");
+			}
+
 			std::cout << project->inputFiles.size() << " files found" << std::endl;
 		}
 		catch (const std::exception& e)
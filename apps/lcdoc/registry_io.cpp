@@ -0,0 +1,521 @@
+#include <map>
+#include <stdexcept>
+
+#include "binary_io.hpp"
+
+#include "registry_io.hpp"
+
+namespace lcdoc
+{
+	namespace
+	{
+		using std::make_shared;
+
+		constexpr uint32_t magic = 0x5244434c; // "LCDR"
+		constexpr uint32_t null_index = 0xffffffff;
+
+		enum class SymbolTag : uint8_t
+		{
+			UnexposedDeclaration,
+			Typedef,
+			Namespace,
+			Enum,
+			Function,
+			StructLike,
+			Struct,
+			Class,
+		};
+
+		enum class TypeTag : uint8_t
+		{
+			Unexposed,
+			Basic,
+			Typedef,
+			Elaborated,
+			Record,
+			Enum,
+			Pointer,
+			LValueReference,
+			RValueReference,
+		};
+
+		SymbolTag symbol_tag(const Symbol& symbol)
+		{
+			if (dynamic_cast<const UnexposedDeclarationSymbol*>(&symbol)) return SymbolTag::UnexposedDeclaration;
+			if (dynamic_cast<const TypedefSymbol*>(&symbol)) return SymbolTag::Typedef;
+			if (dynamic_cast<const NamespaceSymbol*>(&symbol)) return SymbolTag::Namespace;
+			if (dynamic_cast<const EnumSymbol*>(&symbol)) return SymbolTag::Enum;
+			if (dynamic_cast<const FunctionSymbol*>(&symbol)) return SymbolTag::Function;
+			if (dynamic_cast<const StructSymbol*>(&symbol)) return SymbolTag::Struct;
+			if (dynamic_cast<const ClassSymbol*>(&symbol)) return SymbolTag::Class;
+			if (dynamic_cast<const StructLikeSymbol*>(&symbol)) return SymbolTag::StructLike;
+			throw std::runtime_error("cannot serialize symbol of kind " + symbol.kindSpelling());
+		}
+
+		shared_ptr<Symbol> make_symbol(SymbolRegistry& registry, SymbolTag tag, const SymbolIdPart& part, const string& usr)
+		{
+			switch (tag)
+			{
+			case SymbolTag::UnexposedDeclaration: return registry.make<UnexposedDeclarationSymbol>(part, usr);
+			case SymbolTag::Typedef: return registry.make<TypedefSymbol>(part, usr);
+			case SymbolTag::Namespace: return registry.make<NamespaceSymbol>(part, usr);
+			case SymbolTag::Enum: return registry.make<EnumSymbol>(part, usr);
+			case SymbolTag::Function: return registry.make<FunctionSymbol>(part, usr);
+			case SymbolTag::StructLike: return registry.make<StructLikeSymbol>(part, usr);
+			case SymbolTag::Struct: return registry.make<StructSymbol>(part, usr);
+			case SymbolTag::Class: return registry.make<ClassSymbol>(part, usr);
+			}
+			throw std::runtime_error("invalid symbol tag");
+		}
+
+		// assigns an index to every symbol and type reachable from the registry
+		class Tables
+		{
+		public:
+
+			explicit Tables(const SymbolRegistry& registry) : m_registry(registry) {}
+
+			vector<const Symbol*> symbols;
+			vector<const CXXType*> types; // children always come before their parents
+
+			uint32_t symbolIndex(const Symbol* symbol) {
+				if (!symbol)
+					return null_index;
+				auto [it, inserted] = m_symbolIndices.try_emplace(symbol, (uint32_t)this->symbols.size());
+				if (inserted)
+					this->symbols.push_back(symbol);
+				return it->second;
+			}
+
+			uint32_t typeIndex(const Type* type) {
+				const auto cxxType = dynamic_cast<const CXXType*>(type);
+				if (!cxxType)
+					return null_index;
+				if (auto it = m_typeIndices.find(cxxType); it != m_typeIndices.end())
+					return it->second;
+
+				if (auto elaborated = dynamic_cast<const ElaboratedType*>(cxxType))
+					this->typeIndex(elaborated->named.get());
+				if (auto pointer = dynamic_cast<const PointerLikeType*>(cxxType))
+					this->typeIndex(pointer->pointee.get());
+
+				const auto index = (uint32_t)this->types.size();
+				m_typeIndices[cxxType] = index;
+				this->types.push_back(cxxType);
+				return index;
+			}
+
+			// symbols referenced through parents and types are discovered while scanning
+			void scan() {
+				size_t i = 0;
+				while (i < this->symbols.size() || m_scannedTypes < this->types.size())
+				{
+					for (; i < this->symbols.size(); ++i)
+					{
+						const Symbol* symbol = this->symbols[i];
+
+						this->symbolIndex(m_registry.parentOf(*symbol).get());
+
+						if (auto f = dynamic_cast<const FunctionSymbol*>(symbol); f && f->signature)
+						{
+							this->typeIndex(f->signature->ret.get());
+							for (const auto& arg : f->signature->args)
+								this->typeIndex(arg.type.get());
+						}
+
+						if (auto tdef = dynamic_cast<const TypedefSymbol*>(symbol))
+							this->typeIndex(tdef->underlying.get());
+					}
+
+					for (; m_scannedTypes < this->types.size(); ++m_scannedTypes)
+						this->symbolIndex(referenced_symbol(*this->types[m_scannedTypes]));
+				}
+			}
+
+			static const Symbol* referenced_symbol(const CXXType& type) {
+				if (auto record = dynamic_cast<const RecordType*>(&type))
+					return record->recorded.get();
+				if (auto e = dynamic_cast<const EnumType*>(&type))
+					return e->enumSymbol.get();
+				if (auto tdef = dynamic_cast<const TypedefType*>(&type))
+					return tdef->symbol.get();
+				return nullptr;
+			}
+
+		private:
+			const SymbolRegistry& m_registry;
+			std::map<const Symbol*, uint32_t> m_symbolIndices;
+			std::map<const CXXType*, uint32_t> m_typeIndices;
+			size_t m_scannedTypes = 0;
+		};
+
+		void write_location(BinaryWriter& w, const Location& location)
+		{
+			w.str(location.file);
+			w.u32(location.line);
+			w.u32(location.column);
+			w.u32(location.offset);
+		}
+
+		Location read_location(BinaryReader& r)
+		{
+			Location location;
+			location.file = r.str();
+			location.line = r.u32();
+			location.column = r.u32();
+			location.offset = r.u32();
+			return location;
+		}
+
+		// the text is written with the range: the registry can be read on another machine,
+		// or after the source has changed
+		void write_doc_comment(BinaryWriter& w, const DocumentationString& comment)
+		{
+			w.str(comment.range.file);
+			w.u32(comment.range.begin);
+			w.u32(comment.range.end);
+			w.str(comment.text());
+		}
+
+		DocumentationString read_doc_comment(BinaryReader& r)
+		{
+			CommentRange range;
+			range.file = r.str();
+			range.begin = r.u32();
+			range.end = r.u32();
+			return DocumentationString(range, r.str());
+		}
+	}
+
+	void write_registry(std::ostream& out, const SymbolRegistry& registry)
+	{
+		BinaryWriter w(out);
+
+		Tables tables(registry);
+		for (const auto& symbol : registry.symbols)
+			tables.symbolIndex(symbol.get());
+		const size_t nRegistered = tables.symbols.size();
+		for (const auto& [key, type] : registry.types.entries())
+			tables.typeIndex(type.get());
+		tables.scan();
+
+		w.u32(magic);
+		w.u32(registry_format_version);
+
+		// symbols
+		w.u32((uint32_t)tables.symbols.size());
+		for (size_t i = 0; i < tables.symbols.size(); ++i)
+		{
+			const Symbol& symbol = *tables.symbols[i];
+			w.u8((uint8_t)symbol_tag(symbol));
+			w.u8(i < nRegistered);
+			w.str(symbol.idPart().id);
+			w.str(symbol.idPart().spelling);
+			w.str(symbol.idPart().display);
+			w.str(symbol.usr());
+			w.u32(tables.symbolIndex(registry.parentOf(symbol).get()));
+			w.str(symbol.spelling);
+			w.str(symbol.displayName);
+			write_doc_comment(w, symbol.docStr);
+			w.u8(symbol.exposed);
+			w.u32((uint32_t)symbol.declarations.size());
+			for (const auto& location : symbol.declarations)
+				write_location(w, location);
+			w.u32((uint32_t)symbol.definitions.size());
+			for (const auto& location : symbol.definitions)
+				write_location(w, location);
+
+			if (auto e = dynamic_cast<const EnumSymbol*>(&symbol))
+				w.u8(e->scoped);
+			if (auto f = dynamic_cast<const FunctionSymbol*>(&symbol))
+				w.str(f->mangling);
+		}
+
+		// types
+		w.u32((uint32_t)tables.types.size());
+		for (const CXXType* type : tables.types)
+		{
+			if (auto basic = dynamic_cast<const BasicCXXType*>(type))
+			{
+				w.u8((uint8_t)TypeTag::Basic);
+				w.u32((uint32_t)basic->kind());
+			}
+			else if (auto tdef = dynamic_cast<const TypedefType*>(type))
+			{
+				w.u8((uint8_t)TypeTag::Typedef);
+				w.u32(tables.symbolIndex(tdef->symbol.get()));
+				w.str(tdef->typedefName);
+			}
+			else if (auto elaborated = dynamic_cast<const ElaboratedType*>(type))
+			{
+				w.u8((uint8_t)TypeTag::Elaborated);
+				w.u32(tables.typeIndex(elaborated->named.get()));
+			}
+			else if (auto record = dynamic_cast<const RecordType*>(type))
+			{
+				w.u8((uint8_t)TypeTag::Record);
+				w.u32(tables.symbolIndex(record->recorded.get()));
+			}
+			else if (auto e = dynamic_cast<const EnumType*>(type))
+			{
+				w.u8((uint8_t)TypeTag::Enum);
+				w.u32(tables.symbolIndex(e->enumSymbol.get()));
+			}
+			else if (auto pointer = dynamic_cast<const PointerLikeType*>(type))
+			{
+				if (dynamic_cast<const PointerType*>(type))
+					w.u8((uint8_t)TypeTag::Pointer);
+				else if (dynamic_cast<const LValueReferenceType*>(type))
+					w.u8((uint8_t)TypeTag::LValueReference);
+				else
+					w.u8((uint8_t)TypeTag::RValueReference);
+				w.u32(tables.typeIndex(pointer->pointee.get()));
+			}
+			else
+				w.u8((uint8_t)TypeTag::Unexposed);
+
+			w.u8(type->constQualified);
+			w.u8(type->volatileQualified);
+		}
+
+		// interned types
+		w.u32((uint32_t)registry.types.entries().size());
+		for (const auto& [key, type] : registry.types.entries())
+		{
+			w.u32((uint32_t)key.kind);
+			w.u8(key.constQualified);
+			w.u8(key.volatileQualified);
+			w.str(key.spelling);
+			w.str(key.canonicalSpelling);
+			w.str(key.declaration);
+			w.u32(tables.typeIndex(type.get()));
+		}
+
+		// types used by the symbols
+		for (const Symbol* symbol : tables.symbols)
+		{
+			if (auto f = dynamic_cast<const FunctionSymbol*>(symbol))
+			{
+				w.u8((bool)f->signature);
+				if (f->signature)
+				{
+					w.u32(tables.typeIndex(f->signature->ret.get()));
+					w.u32((uint32_t)f->signature->args.size());
+					for (const auto& arg : f->signature->args)
+					{
+						w.u32(tables.typeIndex(arg.type.get()));
+						w.str(arg.name);
+					}
+				}
+			}
+
+			if (auto tdef = dynamic_cast<const TypedefSymbol*>(symbol))
+				w.u32(tables.typeIndex(tdef->underlying.get()));
+		}
+
+		// unhandled declarations
+		w.u32((uint32_t)registry.unhandledDecls.size());
+		for (const auto& decl : registry.unhandledDecls)
+		{
+			w.str(decl.name);
+			write_location(w, decl.location);
+		}
+	}
+
+	SymbolRegistry read_registry(std::istream& in)
+	{
+		BinaryReader r(in);
+
+		if (r.u32() != magic)
+			throw std::runtime_error("not a lcdoc registry file");
+		if (r.u32() != registry_format_version)
+			throw std::runtime_error("unsupported registry format version");
+
+		SymbolRegistry registry;
+
+		// symbols
+		vector<shared_ptr<Symbol>> symbols(r.u32());
+		vector<uint32_t> parents(symbols.size());
+		vector<bool> registered(symbols.size());
+		for (size_t i = 0; i < symbols.size(); ++i)
+		{
+			const auto tag = (SymbolTag)r.u8();
+			registered[i] = r.u8();
+			string id = r.str();
+			string spelling = r.str();
+			string display = r.str();
+			string usr = r.str();
+			auto symbol = make_symbol(registry, tag, SymbolIdPart(id, spelling, display), usr);
+			parents[i] = r.u32();
+			symbol->spelling = r.str();
+			symbol->displayName = r.str();
+			symbol->docStr = read_doc_comment(r);
+			symbol->exposed = r.u8();
+			for (uint32_t n = r.u32(); n > 0; --n)
+				symbol->declarations.insert(read_location(r));
+			for (uint32_t n = r.u32(); n > 0; --n)
+				symbol->definitions.insert(read_location(r));
+
+			if (auto e = std::dynamic_pointer_cast<EnumSymbol>(symbol))
+				e->scoped = r.u8();
+			if (auto f = std::dynamic_pointer_cast<FunctionSymbol>(symbol))
+				f->mangling = r.str();
+
+			symbols[i] = symbol;
+		}
+
+		const auto symbolAt = [&](uint32_t index) -> shared_ptr<Symbol> {
+			if (index == null_index)
+				return nullptr;
+			if (index >= symbols.size())
+				throw std::runtime_error("invalid symbol index");
+			return symbols[index];
+		};
+
+		// types
+		vector<shared_ptr<CXXType>> types(r.u32());
+		const auto typeAt = [&](uint32_t index, size_t limit) -> shared_ptr<CXXType> {
+			if (index == null_index)
+				return nullptr;
+			if (index >= limit)
+				throw std::runtime_error("invalid type index");
+			return types[index];
+		};
+		for (size_t i = 0; i < types.size(); ++i)
+		{
+			shared_ptr<CXXType> type;
+			::CXTypeKind basicKind = ::CXType_Invalid;
+			const auto tag = (TypeTag)r.u8();
+			switch (tag)
+			{
+			case TypeTag::Unexposed:
+				type = make_shared<UnexposedType>();
+				break;
+			case TypeTag::Basic:
+				basicKind = (::CXTypeKind)r.u32();
+				break;
+			case TypeTag::Typedef:
+			{
+				auto tdef = make_shared<TypedefType>();
+				tdef->symbol = std::dynamic_pointer_cast<TypedefSymbol>(symbolAt(r.u32()));
+				tdef->typedefName = r.str();
+				type = tdef;
+				break;
+			}
+			case TypeTag::Elaborated:
+			{
+				auto elaborated = make_shared<ElaboratedType>();
+				elaborated->named = typeAt(r.u32(), i);
+				type = elaborated;
+				break;
+			}
+			case TypeTag::Record:
+			{
+				auto record = make_shared<RecordType>();
+				record->recorded = symbolAt(r.u32());
+				type = record;
+				break;
+			}
+			case TypeTag::Enum:
+			{
+				auto e = make_shared<EnumType>();
+				e->enumSymbol = std::dynamic_pointer_cast<EnumSymbol>(symbolAt(r.u32()));
+				type = e;
+				break;
+			}
+			case TypeTag::Pointer:
+			case TypeTag::LValueReference:
+			case TypeTag::RValueReference:
+			{
+				shared_ptr<PointerLikeType> pointer;
+				if (tag == TypeTag::Pointer)
+					pointer = make_shared<PointerType>();
+				else if (tag == TypeTag::LValueReference)
+					pointer = make_shared<LValueReferenceType>();
+				else
+					pointer = make_shared<RValueReferenceType>();
+				pointer->pointee = typeAt(r.u32(), i);
+				type = pointer;
+				break;
+			}
+			default:
+				throw std::runtime_error("invalid type tag");
+			}
+			const bool constQualified = r.u8();
+			const bool volatileQualified = r.u8();
+			if (tag == TypeTag::Basic)
+			{
+				// the basic types are shared flyweights, they are never modified
+				type = TypeInterner::basic(basicKind, constQualified, volatileQualified);
+				if (!type)
+					throw std::runtime_error("invalid basic type");
+			}
+			else
+			{
+				type->constQualified = constQualified;
+				type->volatileQualified = volatileQualified;
+			}
+			types[i] = type;
+		}
+
+		// interned types
+		TypeInterner interned;
+		for (uint32_t n = r.u32(); n > 0; --n)
+		{
+			TypeInterner::Key key;
+			key.kind = (::CXTypeKind)r.u32();
+			key.constQualified = r.u8();
+			key.volatileQualified = r.u8();
+			key.spelling = r.str();
+			key.canonicalSpelling = r.str();
+			key.declaration = r.str();
+			interned.add(key, typeAt(r.u32(), types.size()));
+		}
+
+		// types used by the symbols
+		for (const auto& symbol : symbols)
+		{
+			if (auto f = std::dynamic_pointer_cast<FunctionSymbol>(symbol))
+			{
+				if (r.u8())
+				{
+					f->signature = std::make_unique<FunctionSignature>();
+					f->signature->ret = typeAt(r.u32(), types.size());
+					for (uint32_t n = r.u32(); n > 0; --n)
+					{
+						FuncArg arg;
+						arg.type = typeAt(r.u32(), types.size());
+						arg.name = r.str();
+						f->signature->args.push_back(std::move(arg));
+					}
+				}
+			}
+
+			if (auto tdef = std::dynamic_pointer_cast<TypedefSymbol>(symbol))
+				tdef->underlying = typeAt(r.u32(), types.size());
+		}
+
+		registry.types = std::move(interned);
+		for (size_t i = 0; i < symbols.size(); ++i)
+			if (registered[i])
+				registry.add(symbols[i]);
+
+		// the parents are written as table indices, the registry has its own
+		for (size_t i = 0; i < symbols.size(); ++i)
+			if (auto parent = symbolAt(parents[i]); parent && registered[i] && registry.symbols.owns(*parent))
+				symbols[i]->parentIndex = parent->index();
+
+		// indexed once the parents are known
+		registry.reindex();
+
+		for (uint32_t n = r.u32(); n > 0; --n)
+		{
+			SymbolRegistry::UnhandledDecl decl;
+			decl.name = r.str();
+			decl.location = read_location(r);
+			registry.unhandledDecls.push_back(std::move(decl));
+		}
+
+		return registry;
+	}
+}
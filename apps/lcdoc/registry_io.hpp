@@ -0,0 +1,18 @@
+#pragma once
+
+#include <istream>
+#include <ostream>
+
+#include "Symbol.hpp"
+
+namespace lcdoc
+{
+	// Binary serialization of a SymbolRegistry, including the parents of the symbols
+	// and the types of the signatures. The format is versioned, reading a file written
+	// with a different version throws.
+	inline constexpr uint32_t registry_format_version = 6;
+
+	void write_registry(std::ostream& out, const SymbolRegistry& registry);
+
+	SymbolRegistry read_registry(std::istream& in);
+}
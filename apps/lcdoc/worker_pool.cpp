@@ -0,0 +1,403 @@
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+#include <algorithm>
+#include <stdexcept>
+#include <format>
+
+#ifndef WIN32
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "binary_io.hpp"
+#include "registry_io.hpp"
+
+#include "worker_pool.hpp"
+
+namespace lcdoc
+{
+#ifdef WIN32
+
+	bool worker_pool_supported()
+	{
+		return false;
+	}
+
+	void run_in_workers(TaskScheduler&, const WorkerPoolOptions&, const std::function<ParsedUnit(size_t)>&, const std::function<void(size_t, optional<ParsedUnit>&&)>&)
+	{
+		throw std::runtime_error("forked workers are not supported on this platform");
+	}
+
+#else
+
+	namespace
+	{
+		using Clock = std::chrono::steady_clock;
+
+		// worker -> parent: u64 task, u8 status, u64 size, then the result or the error message.
+		// The result is the parse time in microseconds (u64), the memory (u64), the #include edges
+		// (u32 count, then the includer and included paths) and the serialized registry
+		enum class FrameStatus : uint8_t
+		{
+			Ok,
+			Error,
+		};
+
+		constexpr size_t frame_header_size = 8 + 1 + 8;
+
+		bool write_all(int fd, const char* data, size_t size)
+		{
+			while (size > 0)
+			{
+				const ssize_t n = ::write(fd, data, size);
+				if (n < 0 && errno == EINTR)
+					continue;
+				if (n <= 0)
+					return false;
+				data += n;
+				size -= (size_t)n;
+			}
+			return true;
+		}
+
+		// false on end of file
+		bool read_all(int fd, char* data, size_t size)
+		{
+			while (size > 0)
+			{
+				const ssize_t n = ::read(fd, data, size);
+				if (n < 0 && errno == EINTR)
+					continue;
+				if (n <= 0)
+					return false;
+				data += n;
+				size -= (size_t)n;
+			}
+			return true;
+		}
+
+		uint64_t decode_u64(const char* bytes)
+		{
+			uint64_t value = 0;
+			for (int i = 0; i < 8; ++i)
+				value |= (uint64_t)(uint8_t)bytes[i] << (8 * i);
+			return value;
+		}
+
+		string encode_u64(uint64_t value)
+		{
+			std::ostringstream out;
+			BinaryWriter(out).u64(value);
+			return std::move(out).str();
+		}
+
+		string frame(uint64_t task, FrameStatus status, const string& payload)
+		{
+			std::ostringstream out;
+			BinaryWriter w(out);
+			w.u64(task);
+			w.u8((uint8_t)status);
+			w.u64(payload.size());
+			out.write(payload.data(), payload.size());
+			return std::move(out).str();
+		}
+
+		[[noreturn]] void worker_main(int tasksFd, int resultsFd, const std::function<ParsedUnit(size_t)>& task)
+		{
+			char index[8];
+			while (read_all(tasksFd, index, sizeof(index)))
+			{
+				const uint64_t i = decode_u64(index);
+
+				string message;
+				try
+				{
+					const ParsedUnit unit = task((size_t)i);
+					std::ostringstream out;
+					BinaryWriter w(out);
+					w.u64((uint64_t)(unit.cost.seconds * 1e6));
+					w.u64(unit.cost.memory);
+					w.u32((uint32_t)unit.inclusions.size());
+					for (const auto& inclusion : unit.inclusions)
+					{
+						w.str(inclusion.includer.string());
+						w.str(inclusion.included.string());
+					}
+					write_registry(out, unit.registry);
+					message = frame(i, FrameStatus::Ok, std::move(out).str());
+				}
+				catch (const std::exception& e)
+				{
+					message = frame(i, FrameStatus::Error, e.what());
+				}
+
+				if (!write_all(resultsFd, message.data(), message.size()))
+					break;
+			}
+
+			// the destructors and the exit handlers belong to the parent
+			std::cout.flush();
+			std::cerr.flush();
+			::_exit(EXIT_SUCCESS);
+		}
+
+		string describe_exit(int status)
+		{
+			if (WIFSIGNALED(status))
+				return std::format("was killed by signal {} ({})", WTERMSIG(status), ::strsignal(WTERMSIG(status)));
+			if (WIFEXITED(status))
+				return std::format("exited with code {}", WEXITSTATUS(status));
+			return "stopped";
+		}
+
+		struct Worker
+		{
+			pid_t pid = -1;
+			int tasksFd = -1; // write end
+			int resultsFd = -1; // read end
+			optional<size_t> task = {};
+			Clock::time_point deadline = {};
+			string received = {};
+		};
+	}
+
+	bool worker_pool_supported()
+	{
+		return true;
+	}
+
+	void run_in_workers(
+		TaskScheduler& scheduler,
+		const WorkerPoolOptions& options,
+		const std::function<ParsedUnit(size_t)>& task,
+		const std::function<void(size_t, optional<ParsedUnit>&&)>& done
+	)
+	{
+		vector<Worker> workers(std::max(1u, options.workers));
+		std::unordered_map<size_t, unsigned> attempts;
+
+		const auto spawn = [&](Worker& worker) {
+			int tasksPipe[2];
+			int resultsPipe[2];
+			if (::pipe(tasksPipe) != 0)
+				throw std::runtime_error(std::format("cannot create a pipe: {}", std::strerror(errno)));
+			if (::pipe(resultsPipe) != 0)
+			{
+				::close(tasksPipe[0]);
+				::close(tasksPipe[1]);
+				throw std::runtime_error(std::format("cannot create a pipe: {}", std::strerror(errno)));
+			}
+
+			// otherwise the buffered output would be written by both processes
+			std::cout.flush();
+			std::cerr.flush();
+
+			const pid_t pid = ::fork();
+			if (pid < 0)
+			{
+				for (const int fd : { tasksPipe[0], tasksPipe[1], resultsPipe[0], resultsPipe[1] })
+					::close(fd);
+				throw std::runtime_error(std::format("cannot fork a worker: {}", std::strerror(errno)));
+			}
+
+			if (pid == 0)
+			{
+				// the worker keeps only its ends of its own pipes, so that the others see the end of file
+				for (const auto& other : workers)
+					if (other.pid > 0)
+					{
+						::close(other.tasksFd);
+						::close(other.resultsFd);
+					}
+				::close(tasksPipe[1]);
+				::close(resultsPipe[0]);
+				worker_main(tasksPipe[0], resultsPipe[1], task);
+			}
+
+			::close(tasksPipe[0]);
+			::close(resultsPipe[1]);
+			worker = Worker{ .pid = pid, .tasksFd = tasksPipe[1], .resultsFd = resultsPipe[0] };
+		};
+
+		const auto reap = [](Worker& worker, bool kill) -> int {
+			if (kill)
+				::kill(worker.pid, SIGKILL);
+			::close(worker.tasksFd);
+			::close(worker.resultsFd);
+
+			int status = 0;
+			while (::waitpid(worker.pid, &status, 0) < 0 && errno == EINTR) {}
+			worker = Worker{};
+			return status;
+		};
+
+		// the task of a crashed or hung worker is retried by a new worker
+		const auto lose = [&](size_t index, const string& reason) {
+			const string name = options.name ? options.name(index) : std::format("task {}", index);
+
+			if (++attempts[index] <= options.retries)
+			{
+				std::cerr << std::format("the worker parsing {} {}, retrying", name, reason) << std::endl;
+				scheduler.retry(index);
+			}
+			else
+			{
+				std::cerr << std::format("the worker parsing {} {}, giving up", name, reason) << std::endl;
+				scheduler.finish(index);
+				done(index, std::nullopt);
+			}
+		};
+
+		const auto shutdown = [&](bool kill) {
+			for (auto& worker : workers)
+				if (worker.pid > 0)
+					reap(worker, kill);
+		};
+
+		// a write to a dead worker must fail with EPIPE instead of killing the parent
+		struct sigaction ignore {};
+		struct sigaction previous {};
+		ignore.sa_handler = SIG_IGN;
+		::sigaction(SIGPIPE, &ignore, &previous);
+
+		try
+		{
+			while (!scheduler.finished())
+			{
+				// one task at a time per worker, so that a crash costs a single task
+				for (auto& worker : workers)
+				{
+					if (worker.task)
+						continue;
+
+					const auto next = scheduler.next(false);
+					if (!next)
+						break;
+
+					if (worker.pid < 0)
+						spawn(worker);
+
+					worker.task = *next;
+					worker.deadline = options.timeout.count() > 0 ? Clock::now() + options.timeout : Clock::time_point::max();
+
+					const string message = encode_u64(*worker.task);
+					if (!write_all(worker.tasksFd, message.data(), message.size()))
+					{
+						const size_t index = *worker.task;
+						lose(index, describe_exit(reap(worker, true)));
+					}
+				}
+
+				vector<pollfd> fds;
+				vector<Worker*> busy;
+				int timeoutMs = -1;
+				const auto now = Clock::now();
+				for (auto& worker : workers)
+					if (worker.task)
+					{
+						fds.push_back({ worker.resultsFd, POLLIN, 0 });
+						busy.push_back(&worker);
+						if (worker.deadline != Clock::time_point::max())
+						{
+							const auto left = std::chrono::ceil<std::chrono::milliseconds>(worker.deadline - now).count();
+							const int ms = (int)std::clamp<long long>(left, 0, 60'000);
+							timeoutMs = timeoutMs < 0 ? ms : std::min(timeoutMs, ms);
+						}
+					}
+
+				if (busy.empty())
+					continue;
+
+				if (::poll(fds.data(), fds.size(), timeoutMs) < 0 && errno != EINTR)
+					throw std::runtime_error(std::format("cannot wait for the workers: {}", std::strerror(errno)));
+
+				for (size_t k = 0; k < busy.size(); ++k)
+				{
+					Worker& worker = *busy[k];
+
+					if (fds[k].revents & (POLLIN | POLLHUP | POLLERR))
+					{
+						char buffer[1 << 16];
+						const ssize_t n = ::read(worker.resultsFd, buffer, sizeof(buffer));
+						if (n < 0 && errno == EINTR)
+							continue;
+						if (n <= 0)
+						{
+							const size_t index = *worker.task;
+							lose(index, describe_exit(reap(worker, false)));
+							continue;
+						}
+						worker.received.append(buffer, (size_t)n);
+
+						if (worker.received.size() < frame_header_size)
+							continue;
+						const uint64_t size = decode_u64(worker.received.data() + 9);
+						if (worker.received.size() - frame_header_size < size)
+							continue;
+
+						const size_t index = (size_t)decode_u64(worker.received.data());
+						const auto status = (FrameStatus)worker.received[8];
+						const string payload = worker.received.substr(frame_header_size, size);
+						worker.received.clear();
+						worker.task.reset();
+
+						if (status == FrameStatus::Ok)
+						{
+							optional<ParsedUnit> unit;
+							try
+							{
+								std::istringstream in(payload);
+								BinaryReader r(in);
+								ParseCost cost;
+								cost.seconds = (double)r.u64() / 1e6;
+								cost.memory = r.u64();
+								vector<clang::Inclusion> inclusions(r.u32());
+								for (auto& inclusion : inclusions)
+								{
+									inclusion.includer = r.str();
+									inclusion.included = r.str();
+								}
+								unit = ParsedUnit{ read_registry(in), cost, std::move(inclusions) };
+							}
+							catch (const std::exception& e)
+							{
+								std::cerr << "corrupted result from a worker: " << e.what() << std::endl;
+							}
+							scheduler.finish(index, unit ? optional<uint64_t>(unit->cost.memory) : std::nullopt);
+							done(index, std::move(unit));
+						}
+						else
+						{
+							std::cerr << (options.name ? options.name(index) : std::format("task {}", index)) << ": " << payload << std::endl;
+							scheduler.finish(index);
+							done(index, std::nullopt);
+						}
+					}
+					else if (Clock::now() >= worker.deadline)
+					{
+						const size_t index = *worker.task;
+						reap(worker, true);
+						lose(index, std::format("timed out after {}s", options.timeout.count()));
+					}
+				}
+			}
+		}
+		catch (...)
+		{
+			shutdown(true);
+			::sigaction(SIGPIPE, &previous, nullptr);
+			throw;
+		}
+
+		// the workers exit when their task pipe is closed
+		shutdown(false);
+		::sigaction(SIGPIPE, &previous, nullptr);
+	}
+
+#endif
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include "clang_interface/TranslationUnit.hpp"
+#include "Symbol.hpp"
+#include "ParseHistory.hpp"
+#include "TaskScheduler.hpp"
+
+namespace lcdoc
+{
+	using std::string;
+	using std::vector;
+	using std::optional;
+
+	struct WorkerPoolOptions
+	{
+		unsigned workers = 1;
+
+		// time a worker may spend on one task before it is killed, zero for no limit
+		std::chrono::seconds timeout{ 0 };
+
+		// attempts of a task after its worker crashed or timed out
+		unsigned retries = 1;
+
+		// name of a task in the error messages
+		std::function<string(size_t)> name;
+	};
+
+	struct ParsedUnit
+	{
+		SymbolRegistry registry;
+		ParseCost cost;
+		vector<clang::Inclusion> inclusions;
+	};
+
+	// forked workers are available on POSIX systems only
+	bool worker_pool_supported();
+
+	// Runs `task` for every task of `scheduler` in a pool of forked worker processes, one task at a time
+	// per worker. The results are serialized back to the parent through a pipe and handed to `done`
+	// (in the parent, in completion order) as soon as they arrive. A worker that crashes or exceeds the
+	// timeout is killed and replaced, and its task is retried; `done` gets nullopt for the tasks that
+	// failed every attempt or threw.
+	// Must be called while the process has a single thread: the workers are forked from it.
+	void run_in_workers(
+		TaskScheduler& scheduler,
+		const WorkerPoolOptions& options,
+		const std::function<ParsedUnit(size_t)>& task,
+		const std::function<void(size_t, optional<ParsedUnit>&&)>& done
+	);
+}
@@ -14,4 +14,26 @@
 */
 int somma(int a, int b) {
     return a + b;
-}
\ No newline at end of file
+}
+
+namespace first
+{
+    /// @brief A typedef named like the one of the namespace second.
+    typedef int T;
+
+    /// @brief Uses first::T, its documentation must link to first::T.
+    T identity(T value) {
+        return value;
+    }
+}
+
+namespace second
+{
+    /// @brief Same name and same underlying type as first::T, but a different typedef.
+    typedef int T;
+
+    /// @brief Uses second::T, its documentation must link to second::T and not to first::T.
+    T identity(T value) {
+        return value;
+    }
+}